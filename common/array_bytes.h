@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Bytes for `size` elements of `elem_size` after a `header` of bytes, rounded up to
+// `align`. Throws `std::bad_array_new_length` instead of wrapping around, as `new T[size]`
+// does: a wrapped size would allocate a short block and construct past its end
+inline size_t ArrayBytes(size_t size, size_t elem_size, size_t header = 0, size_t align = 1) {
+    if (elem_size != 0 && size > (SIZE_MAX - header) / elem_size) {
+        throw std::bad_array_new_length();
+    }
+    size_t bytes = header + size * elem_size;
+    if (bytes > SIZE_MAX - (align - 1)) {
+        throw std::bad_array_new_length();
+    }
+    return (bytes + align - 1) / align * align;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Passed to a member that has no initializer: it is default-initialized, like a plain data
+// member left out of a constructor's init list. Raw storage stays untouched
+struct CompressedDefaultInit {};
+
+// One member of a `CompressedTuple`. The index keeps leaves of equal types distinct
+template <size_t I, typename T, bool Empty = std::is_empty_v<T> && !std::is_final_v<T>>
+class CompressedLeaf {
+public:
+    constexpr explicit CompressedLeaf(CompressedDefaultInit) {
+    }
+
+    template <typename U>
+    constexpr explicit CompressedLeaf(U&& value) : value_(std::forward<U>(value)) {
+    }
+
+    constexpr T& Get() {
+        return value_;
+    }
+
+    constexpr const T& Get() const {
+        return value_;
+    }
+
+private:
+    T value_;
+};
+
+// Empty members are bases, so they take no space
+template <size_t I, typename T>
+class CompressedLeaf<I, T, true> : private T {
+public:
+    constexpr explicit CompressedLeaf(CompressedDefaultInit) : T() {
+    }
+
+    template <typename U>
+    constexpr explicit CompressedLeaf(U&& value) : T(std::forward<U>(value)) {
+    }
+
+    constexpr T& Get() {
+        return *this;
+    }
+
+    constexpr const T& Get() const {
+        return *this;
+    }
+};
+
+template <size_t I, typename T, typename... Ts>
+struct CompressedElement : CompressedElement<I - 1, Ts...> {};
+
+template <typename T, typename... Ts>
+struct CompressedElement<0, T, Ts...> {
+    using Type = T;
+};
+
+// Initializer of the `I`-th member: the `I`-th argument, if there is one
+template <size_t I>
+constexpr CompressedDefaultInit PickCompressedInit() {
+    return {};
+}
+
+template <size_t I, typename U, typename... Us>
+constexpr decltype(auto) PickCompressedInit(U&& first, Us&&... rest) {
+    if constexpr (I == 0) {
+        return std::forward<U>(first);
+    } else {
+        return PickCompressedInit<I - 1>(std::forward<Us>(rest)...);
+    }
+}
+
+template <typename Indices, typename... Ts>
+class CompressedTupleImpl;
+
+template <size_t... Is, typename... Ts>
+class CompressedTupleImpl<std::index_sequence<Is...>, Ts...> : private CompressedLeaf<Is, Ts>... {
+public:
+    template <size_t I>
+    using Element = typename CompressedElement<I, Ts...>::Type;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    // Initializers go to the leading members, the rest are default-initialized
+    template <typename... Us>
+        requires(sizeof...(Us) <= sizeof...(Ts))
+    constexpr explicit CompressedTupleImpl(std::in_place_t, Us&&... args)
+        : CompressedLeaf<Is, Ts>(PickCompressedInit<Is>(std::forward<Us>(args)...))... {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    template <size_t I>
+    constexpr Element<I>& Get() {
+        return static_cast<CompressedLeaf<I, Element<I>>&>(*this).Get();
+    }
+
+    template <size_t I>
+    constexpr const Element<I>& Get() const {
+        return static_cast<const CompressedLeaf<I, Element<I>>&>(*this).Get();
+    }
+};
+
+// N-ary `CompressedPair`: every empty, non-final member takes no space.
+// Empty members of the same type still get distinct addresses, as the language requires
+template <typename... Ts>
+class CompressedTuple : public CompressedTupleImpl<std::index_sequence_for<Ts...>, Ts...> {
+    using Impl = CompressedTupleImpl<std::index_sequence_for<Ts...>, Ts...>;
+
+public:
+    constexpr CompressedTuple() : Impl(std::in_place) {
+    }
+
+    template <typename... Us>
+        requires(sizeof...(Us) <= sizeof...(Ts) &&
+                 !(sizeof...(Us) == 1 &&
+                   (std::is_same_v<std::remove_cvref_t<Us>, CompressedTuple> && ...)))
+    constexpr explicit CompressedTuple(Us&&... args)
+        : Impl(std::in_place, std::forward<Us>(args)...) {
+    }
+};
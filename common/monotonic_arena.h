@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Bump allocator over a list of chunks. Individual allocations are never freed:
+// `Reset()` releases every chunk at once. Not thread-safe
+class MonotonicArena {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit MonotonicArena(size_t initial_chunk_size = 4096)
+        : initial_chunk_size_(initial_chunk_size), next_chunk_size_(initial_chunk_size) {
+    }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~MonotonicArena() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        auto current = reinterpret_cast<uintptr_t>(current_);
+        uintptr_t aligned = (current + align - 1) & ~(uintptr_t{align} - 1);
+        if (!head_ || aligned + size > reinterpret_cast<uintptr_t>(end_)) {
+            AddChunk(size + align);
+            current = reinterpret_cast<uintptr_t>(current_);
+            aligned = (current + align - 1) & ~(uintptr_t{align} - 1);
+        }
+        current_ = reinterpret_cast<std::byte*>(aligned + size);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    template <typename T>
+    T* Allocate() {
+        return static_cast<T*>(Allocate(sizeof(T), alignof(T)));
+    }
+
+    // Frees every chunk, and chunks start small again, so an arena reused for one request
+    // after another doesn't keep growing. Objects placed in the arena must be destroyed by now
+    void Reset() {
+        while (head_) {
+            Chunk* next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+        current_ = end_ = nullptr;
+        next_chunk_size_ = initial_chunk_size_;
+        chunk_count_ = 0;
+        capacity_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t ChunkCount() const {
+        return chunk_count_;
+    }
+
+    // Bytes held in chunks, used or not
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+private:
+    struct Chunk {
+        Chunk* next;
+    };
+
+    // Chunks grow geometrically, so a long-lived arena makes few system allocations
+    void AddChunk(size_t min_size) {
+        size_t size = std::max(next_chunk_size_, min_size + sizeof(Chunk));
+        next_chunk_size_ = size * 2;
+        auto* chunk = static_cast<Chunk*>(::operator new(size));
+        chunk->next = std::exchange(head_, chunk);
+        current_ = reinterpret_cast<std::byte*>(chunk + 1);
+        end_ = reinterpret_cast<std::byte*>(chunk) + size;
+        ++chunk_count_;
+        capacity_ += size;
+    }
+
+    Chunk* head_ = nullptr;
+    std::byte* current_ = nullptr;
+    std::byte* end_ = nullptr;
+    size_t initial_chunk_size_;
+    size_t next_chunk_size_;
+    size_t chunk_count_ = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pointers are aligned, so their low bits are almost always zero and identity hashing
+// piles them into a fraction of the buckets. A xor-shift, a multiply and another xor-shift:
+// the first round of MurmurHash3's fmix64 finalizer, which has two. The multiply carries
+// every bit upwards and the final shift folds the high bits back into the low ones that
+// pick the bucket. Not a full avalanche, but cheap, and enough to spread pointers
+inline size_t MixPointer(const void* ptr) {
+    uint64_t x = reinterpret_cast<uintptr_t>(ptr);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+}
+
+struct PointerHash {
+    size_t operator()(const void* ptr) const {
+        return MixPointer(ptr);
+    }
+};
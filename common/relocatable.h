@@ -0,0 +1,12 @@
+#pragma once
+
+#include <type_traits>
+
+// A trivially relocatable object can be moved to new storage by copying its bytes, after
+// which the old copy is forgotten, not destroyed. Smart pointers hold no pointers into
+// themselves, so they opt in even though their moves and destructors are non-trivial
+template <typename T>
+struct IsTriviallyRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<T>::value;
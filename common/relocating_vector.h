@@ -0,0 +1,191 @@
+#pragma once
+
+#include "relocatable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Growable array that moves trivially relocatable elements with `realloc`: growing
+// a vector of smart pointers is a `memcpy` at worst, with no reference count traffic
+// and no moved-from objects to destroy
+template <typename T>
+class RelocatingVector {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "malloc can't align T");
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    RelocatingVector() = default;
+
+    RelocatingVector(RelocatingVector&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {
+    }
+
+    RelocatingVector(const RelocatingVector&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    RelocatingVector& operator=(RelocatingVector&& other) noexcept {
+        if (this != &other) {
+            Clear();
+            std::free(data_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    RelocatingVector& operator=(const RelocatingVector&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~RelocatingVector() {
+        Clear();
+        std::free(data_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ == capacity_) {
+            // `args` may refer to an element, build the new one before moving them
+            T value(std::forward<Args>(args)...);
+            Reallocate(GrownCapacity());
+            return *new (data_ + size_++) T(std::move(value));
+        }
+        return *new (data_ + size_++) T(std::forward<Args>(args)...);
+    }
+
+    void PushBack(T value) {
+        EmplaceBack(std::move(value));
+    }
+
+    void PopBack() {
+        data_[--size_].~T();
+    }
+
+    // Throws `std::length_error` past `MaxSize()`, like `std::vector`
+    void Reserve(size_t capacity) {
+        if (capacity > MaxSize()) {
+            throw std::length_error("RelocatingVector::Reserve");
+        }
+        if (capacity > capacity_) {
+            Reallocate(capacity);
+        }
+    }
+
+    void Clear() {
+        std::destroy(data_, data_ + size_);
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Size() const {
+        return size_;
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    // Most elements whose bytes fit in `size_t`
+    static constexpr size_t MaxSize() {
+        return SIZE_MAX / sizeof(T);
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    T* Data() {
+        return data_;
+    }
+
+    const T* Data() const {
+        return data_;
+    }
+
+    T& operator[](size_t index) {
+        return data_[index];
+    }
+
+    const T& operator[](size_t index) const {
+        return data_[index];
+    }
+
+    T* begin() {
+        return data_;
+    }
+
+    T* end() {
+        return data_ + size_;
+    }
+
+    const T* begin() const {
+        return data_;
+    }
+
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    // Doubles, up to `MaxSize()`
+    size_t GrownCapacity() const {
+        if (capacity_ == MaxSize()) {
+            throw std::length_error("RelocatingVector::EmplaceBack");
+        }
+        return capacity_ ? (capacity_ > MaxSize() / 2 ? MaxSize() : 2 * capacity_) : 4;
+    }
+
+    void Reallocate(size_t capacity) {
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            void* fresh = std::realloc(static_cast<void*>(data_), capacity * sizeof(T));
+            if (!fresh) {
+                throw std::bad_alloc();
+            }
+            data_ = static_cast<T*>(fresh);
+        } else {
+            T* fresh = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+            if (!fresh) {
+                throw std::bad_alloc();
+            }
+            // A throwing copy leaves the old buffer untouched: only the new one is undone
+            size_t built = 0;
+            try {
+                for (; built < size_; ++built) {
+                    new (fresh + built) T(std::move_if_noexcept(data_[built]));
+                }
+            } catch (...) {
+                std::destroy(fresh, fresh + built);
+                std::free(fresh);
+                throw;
+            }
+            std::destroy(data_, data_ + size_);
+            std::free(data_);
+            data_ = fresh;
+        }
+        capacity_ = capacity;
+    }
+
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
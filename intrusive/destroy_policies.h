@@ -0,0 +1,227 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <common/monotonic_arena.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Destroy policies for `RefCounted`, used in place of `DefaultDelete`. A policy is stateless,
+// so it adds nothing to the object: one that needs to know where the object came from asks
+// `Home::HomeOf(object)`. A home may be a single global (`StaticHome`) or be found from the
+// object's address (`IntrusivePool`)
+
+// Home that is always the same object with static storage duration:
+//     DeferredReclaimer reclaimer;
+//     struct Node : RefCounted<Node, SimpleCounter, DeferredDestroy<StaticHome<reclaimer>>>
+template <auto& Home>
+struct StaticHome {
+    template <typename T>
+    static auto& HomeOf(T*) {
+        return Home;
+    }
+};
+
+// Hands the object back to its pool, which decides what to do with it
+template <typename Home>
+struct ReturnToPool {
+    template <typename T>
+    static void Destroy(T* object) {
+        Home::HomeOf(object).Release(object);
+    }
+};
+
+// Runs the destructor only: the memory belongs to an arena and goes away with it
+struct ArenaDestroy {
+    template <typename T>
+    static void Destroy(T* object) {
+        object->~T();
+    }
+};
+
+// Queues the object for a reclaimer, which destroys it later through `Deleter`, e.g. away
+// from a latency-sensitive thread or once no reader can still be looking at it
+template <typename Home, typename Deleter = DefaultDelete>
+struct DeferredDestroy {
+    template <typename T>
+    static void Destroy(T* object) {
+        Home::HomeOf(object).template Defer<Deleter>(object);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Objects whose last reference is gone, waiting for `Reclaim()`. Thread-safe
+class DeferredReclaimer {
+public:
+    DeferredReclaimer() = default;
+
+    DeferredReclaimer(const DeferredReclaimer&) = delete;
+    DeferredReclaimer& operator=(const DeferredReclaimer&) = delete;
+
+    // Whatever is still queued is destroyed now
+    ~DeferredReclaimer() {
+        while (Reclaim() > 0) {
+        }
+    }
+
+    template <typename Deleter, typename T>
+    void Defer(T* object) {
+        std::lock_guard lock(mutex_);
+        pending_.push_back({object, [](void* ptr) { Deleter::Destroy(static_cast<T*>(ptr)); }});
+    }
+
+    // Destroys everything queued so far, outside the lock: destructors may drop references
+    // and queue more objects, which wait for the next call. Returns the number destroyed
+    size_t Reclaim() {
+        std::vector<Pending> pending;
+        {
+            std::lock_guard lock(mutex_);
+            pending.swap(pending_);
+        }
+        for (auto& entry : pending) {
+            entry.destroy(entry.object);
+        }
+        return pending.size();
+    }
+
+    size_t NumPending() const {
+        std::lock_guard lock(mutex_);
+        return pending_.size();
+    }
+
+private:
+    struct Pending {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Pending> pending_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fixed-size slots carved from slabs aligned to `SlabSize`. Each slab starts with a pointer
+// to its pool, so `HomeOf` finds the pool by masking the object's address and the objects
+// carry nothing extra. Released slots are reused by later `Make` calls and the slabs are
+// freed with the pool. Not thread-safe.
+//     struct Node : RefCounted<Node, SimpleCounter, ReturnToPool<IntrusivePool<Node>>>
+template <typename T, size_t SlabSize = size_t{64} << 10>
+class IntrusivePool {
+    static_assert((SlabSize & (SlabSize - 1)) == 0, "Slab size must be a power of two");
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    IntrusivePool() = default;
+
+    IntrusivePool(const IntrusivePool&) = delete;
+    IntrusivePool& operator=(const IntrusivePool&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    // Every object must have been released by now
+    ~IntrusivePool() {
+        while (slabs_) {
+            Slab* next = slabs_->next;
+            ::operator delete(slabs_, std::align_val_t(SlabSize));
+            slabs_ = next;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Objects
+
+    template <typename... Args>
+    IntrusivePtr<T> Make(Args&&... args) {
+        void* slot = TakeSlot();
+        T* object;
+        try {
+            object = new (slot) T(std::forward<Args>(args)...);
+        } catch (...) {
+            free_ = new (slot) FreeSlot{free_};
+            throw;
+        }
+        ++in_use_;
+        object->InitRefCount();
+        return IntrusivePtr<T>(object, AdoptRef{});
+    }
+
+    void Release(T* object) {
+        object->~T();
+        free_ = new (object) FreeSlot{free_};
+        --in_use_;
+    }
+
+    static IntrusivePool& HomeOf(T* object) {
+        auto slab = reinterpret_cast<uintptr_t>(object) & ~(uintptr_t{SlabSize} - 1);
+        return *reinterpret_cast<Slab*>(slab)->home;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t NumInUse() const {
+        return in_use_;
+    }
+
+    size_t NumSlabs() const {
+        return num_slabs_;
+    }
+
+private:
+    struct Slab {
+        IntrusivePool* home;
+        Slab* next;
+    };
+
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    static constexpr size_t kSlotAlign = std::max(alignof(T), alignof(FreeSlot));
+    static constexpr size_t kSlotSize =
+        (std::max(sizeof(T), sizeof(FreeSlot)) + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+    static constexpr size_t kFirstSlot = (sizeof(Slab) + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+    static_assert(kFirstSlot + kSlotSize <= SlabSize && kSlotAlign <= SlabSize,
+                  "Slab too small for the object");
+
+    void* TakeSlot() {
+        if (free_) {
+            return std::exchange(free_, free_->next);
+        }
+        if (static_cast<size_t>(end_ - cursor_) < kSlotSize) {
+            auto* slab =
+                static_cast<std::byte*>(::operator new(SlabSize, std::align_val_t(SlabSize)));
+            slabs_ = new (slab) Slab{this, slabs_};
+            ++num_slabs_;
+            cursor_ = slab + kFirstSlot;
+            end_ = slab + SlabSize;
+        }
+        return std::exchange(cursor_, cursor_ + kSlotSize);
+    }
+
+    Slab* slabs_ = nullptr;
+    FreeSlot* free_ = nullptr;
+    std::byte* cursor_ = nullptr;
+    std::byte* end_ = nullptr;
+    size_t in_use_ = 0;
+    size_t num_slabs_ = 0;
+};
+
+// For types destroyed with `ArenaDestroy`. The object must be gone before `arena` is reset
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeArenaIntrusive(MonotonicArena& arena, Args&&... args) {
+    T* object = new (arena.Allocate<T>()) T(std::forward<Args>(args)...);
+    object->InitRefCount();
+    return IntrusivePtr<T>(object, AdoptRef{});
+}
@@ -1,27 +1,147 @@
 #pragma once
 
-#include <cstddef>  // for std::nullptr_t
-#include <utility>  // for std::exchange / std::swap
+#include <common/pointer_hash.h>
+#include <common/relocatable.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>     // for std::nullptr_t
+#include <functional>  // for std::hash
+#include <limits>
+#include <type_traits>
+#include <utility>     // for std::exchange / std::swap
+
+// What a counter does when a reference would take it past its largest value
+enum class CounterOverflow {
+    // Nothing: the owner guarantees the count fits
+    kUnchecked,
+    // The count sticks at the maximum and the object is never destroyed. Leaks the object
+    // rather than wrapping around and destroying it while it is still referenced
+    kStick,
+};
+
+// Counter of a selectable width: a 16-bit count saves 6 bytes per object over `size_t`
+template <typename UInt, CounterOverflow Overflow = CounterOverflow::kUnchecked>
+class SimpleCounterOf {
+    static_assert(std::is_unsigned_v<UInt>, "Counter must be an unsigned integer");
 
-class SimpleCounter {
 public:
+    static constexpr UInt kMax = std::numeric_limits<UInt>::max();
+    static constexpr CounterOverflow kOverflow = Overflow;
+
     size_t IncRef() {
-        count_++;
+        if (!Stuck()) {
+            count_++;
+        }
         return count_;
     }
     size_t DecRef() {
-        count_--;
+        if (!Stuck()) {
+            count_--;
+        }
         return count_;
     }
 
+    // Fails once the count has dropped to zero
+    bool TryIncRef() {
+        if (count_ == 0) {
+            return false;
+        }
+        IncRef();
+        return true;
+    }
+
     size_t RefCount() const {
         return count_;
     }
 
+    // Only before the object is shared
+    void Init(size_t count) {
+        count_ = static_cast<UInt>(std::min<size_t>(count, kMax));
+    }
+
 private:
-    size_t count_ = 0;
+    bool Stuck() const {
+        return Overflow == CounterOverflow::kStick && count_ == kMax;
+    }
+
+    UInt count_ = 0;
 };
 
+// Counter for objects shared between threads. Taking a reference needs no ordering: the
+// caller already holds one. Dropping one is acq_rel, so every owner's accesses to the object
+// happen before the destruction by whoever drops the last reference.
+// The sticky variant has to compare before writing, so it costs a CAS loop per operation
+template <typename UInt, CounterOverflow Overflow = CounterOverflow::kUnchecked>
+class AtomicCounterOf {
+    static_assert(std::is_unsigned_v<UInt>, "Counter must be an unsigned integer");
+
+public:
+    static constexpr UInt kMax = std::numeric_limits<UInt>::max();
+    static constexpr CounterOverflow kOverflow = Overflow;
+
+    size_t IncRef() {
+        if constexpr (Overflow == CounterOverflow::kStick) {
+            UInt count = count_.load(std::memory_order_relaxed);
+            while (count != kMax && !count_.compare_exchange_weak(count, count + 1,
+                                                                  std::memory_order_relaxed)) {
+            }
+            return count == kMax ? kMax : count + 1;
+        } else {
+            return static_cast<UInt>(count_.fetch_add(1, std::memory_order_relaxed) + 1);
+        }
+    }
+
+    size_t DecRef() {
+        if constexpr (Overflow == CounterOverflow::kStick) {
+            UInt count = count_.load(std::memory_order_relaxed);
+            while (count != kMax &&
+                   !count_.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed)) {
+            }
+            return count == kMax ? kMax : count - 1;
+        } else {
+            return static_cast<UInt>(count_.fetch_sub(1, std::memory_order_acq_rel) - 1);
+        }
+    }
+
+    // Fails once the count has dropped to zero: an object being destroyed can't be revived
+    bool TryIncRef() {
+        UInt count = count_.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (Overflow == CounterOverflow::kStick && count == kMax) {
+                return true;
+            }
+            if (count_.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t RefCount() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    // Only before the object is shared: a plain store, no read-modify-write
+    void Init(size_t count) {
+        count_.store(static_cast<UInt>(std::min<size_t>(count, kMax)), std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<UInt> count_ = 0;
+};
+
+using SimpleCounter = SimpleCounterOf<size_t>;
+using AtomicCounter = AtomicCounterOf<size_t>;
+
+// Narrow counters that make an object immortal instead of overflowing
+template <typename UInt>
+using StickyCounter = SimpleCounterOf<UInt, CounterOverflow::kStick>;
+
+template <typename UInt>
+using StickyAtomicCounter = AtomicCounterOf<UInt, CounterOverflow::kStick>;
+
 struct DefaultDelete {
     template <typename T>
     static void Destroy(T* object) {
@@ -32,6 +152,17 @@ struct DefaultDelete {
 template <typename Derived, typename Counter, typename Deleter>
 class RefCounted {
 public:
+    RefCounted() = default;
+
+    // A copy is a new object nobody refers to yet, and assignment doesn't change
+    // who refers to the target
+    RefCounted(const RefCounted&) {
+    }
+
+    RefCounted& operator=(const RefCounted&) {
+        return *this;
+    }
+
     // Increase reference counter.
     void IncRef() {
         counter_.IncRef();
@@ -39,19 +170,45 @@ public:
 
     // Decrease reference counter.
     // Destroy object using Deleter when the last instance dies.
+    // The decrement itself tells who was last: with a separate read of the counter
+    // two threads could both see 2 and neither destroy, or both see 1 and both destroy
     void DecRef() {
-        if (counter_.RefCount() <= 1) {
+        if (counter_.DecRef() == 0) {
             Deleter::Destroy(static_cast<Derived*>(this));
-        } else {
-            counter_.DecRef();
         }
     }
 
+    // Increase reference counter unless it has already dropped to zero.
+    bool TryIncRef() {
+        return counter_.TryIncRef();
+    }
+
     // Get current counter value (the number of strong references).
     size_t RefCount() const {
         return counter_.RefCount();
     }
 
+    // For factories: give a fresh object, not yet visible to anybody else, its first
+    // reference, to be adopted by an `IntrusivePtr`.
+    void InitRefCount() {
+        counter_.Init(1);
+    }
+
+    // Never destroyed from now on, and references are taken and dropped without writing
+    // the counter. Call once, before the object is shared. Needs a sticky counter,
+    // which is pinned at its maximum
+    void MakeImmortal()
+        requires(Counter::kOverflow == CounterOverflow::kStick)
+    {
+        counter_.Init(Counter::kMax);
+    }
+
+    bool Immortal() const
+        requires(Counter::kOverflow == CounterOverflow::kStick)
+    {
+        return counter_.RefCount() == Counter::kMax;
+    }
+
 private:
     Counter counter_;
 };
@@ -59,6 +216,23 @@ private:
 template <typename Derived, typename D = DefaultDelete>
 using SimpleRefCounted = RefCounted<Derived, SimpleCounter, D>;
 
+// `IntrusivePtr`s to it may be copied and dropped concurrently
+template <typename Derived, typename D = DefaultDelete>
+using ThreadSafeRefCounted = RefCounted<Derived, AtomicCounter, D>;
+
+// The counter is all `RefCounted` holds, and the base comes first in `Derived`, so a narrow
+// counter lands in what would be padding before a wider member: with a 16-bit counter,
+// `{uint16_t tag; uint32_t key; Node* next;}` takes no more room than without one.
+// `static_assert(kRefCountOverhead<Node, NodeFields> == 0)` checks it, where `NodeFields`
+// is a plain struct with the same members as `Node`
+template <typename Derived, typename Fields>
+inline constexpr size_t kRefCountOverhead = sizeof(Derived) - sizeof(Fields);
+
+// `IntrusivePtr(ptr, AdoptRef{})` takes over a reference the caller already holds,
+// `IntrusivePtr(ptr, RetainRef{})` takes a new one, same as `IntrusivePtr(ptr)`
+struct AdoptRef {};
+struct RetainRef {};
+
 template <typename T>
 class IntrusivePtr {
     template <typename Y>
@@ -78,6 +252,12 @@ public:
             ;
         }
     }
+
+    IntrusivePtr(T* ptr, AdoptRef) noexcept : ptr_(ptr) {
+    }
+
+    IntrusivePtr(T* ptr, RetainRef) : IntrusivePtr(ptr) {
+    }
     //
     //    template <class Y>
     //    IntrusivePtr(Y* ptr) : ptr_(ptr) {
@@ -93,7 +273,7 @@ public:
     }
 
     template <typename Y>
-    IntrusivePtr(IntrusivePtr<Y>&& other) {
+    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept {
         ptr_ = std::move(other.ptr_);
         other.ptr_ = nullptr;
     }
@@ -105,7 +285,7 @@ public:
         }
     }
 
-    IntrusivePtr(IntrusivePtr&& other) {
+    IntrusivePtr(IntrusivePtr&& other) noexcept {
         ptr_ = std::move(other.ptr_);
         other.ptr_ = nullptr;
     }
@@ -125,7 +305,7 @@ public:
         return *this;
     }
 
-    IntrusivePtr& operator=(IntrusivePtr&& other) {
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
         if (this == &other) {
             return *this;
         }
@@ -156,16 +336,25 @@ public:
     }
 
     void Reset(T* ptr) {
+        if (ptr) {
+            ptr->IncRef();
+        }
         if (ptr_) {
             ptr_->DecRef();
         }
         ptr_ = ptr;
     }
 
-    void Swap(IntrusivePtr& other) {
+    void Swap(IntrusivePtr& other) noexcept {
         std::swap(ptr_, other.ptr_);
     }
 
+    // Gives up ownership without `DecRef()`: the caller now holds the reference,
+    // e.g. to pass it through a C API and adopt it back later
+    [[nodiscard]] T* Detach() noexcept {
+        return std::exchange(ptr_, nullptr);
+    }
+
     // Observers
     T* Get() const {
         return ptr_;
@@ -194,8 +383,38 @@ private:
     T* ptr_;
 };
 
+// For singletons in static storage:
+//     static Node node;
+//     static const IntrusivePtr<Node> kNode = MakeImmortal(node);
+template <typename T>
+IntrusivePtr<T> MakeImmortal(T& object) {
+    object.MakeImmortal();
+    return IntrusivePtr<T>(&object, AdoptRef{});
+}
+
+// `RefCounted` objects start with their count at 1, no increment needed
 template <typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args&&... args) {
-    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+    T* object = new T(std::forward<Args>(args)...);
+    if constexpr (requires { object->InitRefCount(); }) {
+        object->InitRefCount();
+        return IntrusivePtr<T>(object, AdoptRef{});
+    } else {
+        return IntrusivePtr<T>(object);
+    }
 }
 
+template <typename T, typename U>
+inline bool operator==(const IntrusivePtr<T>& left, const IntrusivePtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusivePtr<T>> : std::true_type {};
+
+template <typename T>
+struct std::hash<IntrusivePtr<T>> {
+    size_t operator()(const IntrusivePtr<T>& ptr) const {
+        return MixPointer(ptr.Get());
+    }
+};
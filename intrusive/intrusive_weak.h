@@ -0,0 +1,193 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <atomic>
+#include <cstddef>  // for std::nullptr_t
+#include <mutex>
+#include <utility>  // for std::exchange / std::swap
+
+// Side block shared by the weak references to one object, allocated on the first of them.
+// It outlives the object. The object clears `alive_` under `mutex_` before it goes away,
+// and `TryIncRef` reads it under the same mutex, so a locker that sees it set may still
+// touch the object's counter
+class IntrusiveWeakToken {
+public:
+    void AddRef() {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    bool Alive() const {
+        return alive_.load(std::memory_order_acquire);
+    }
+
+    void Expire() {
+        std::lock_guard lock(mutex_);
+        alive_.store(false, std::memory_order_release);
+    }
+
+    template <typename T>
+    bool TryIncRef(T* object) {
+        std::lock_guard lock(mutex_);
+        return alive_.load(std::memory_order_relaxed) && object->TryIncRef();
+    }
+
+private:
+    std::mutex mutex_;
+    std::atomic<bool> alive_ = true;
+    std::atomic<size_t> refs_ = 1;  // The object's own reference
+};
+
+// Expires weak references first, so none can lock the object while it is destroyed,
+// nor after a pool has handed it out again
+template <typename Deleter>
+struct ExpireWeakThen {
+    template <typename T>
+    static void Destroy(T* object) {
+        object->ExpireWeakRefs();
+        Deleter::Destroy(object);
+    }
+};
+
+// `RefCounted` that `IntrusiveWeakPtr` can observe. Costs one pointer in the object;
+// the token is allocated only when the first weak reference is made.
+// Types that never need weak references keep using `RefCounted` and pay nothing
+template <typename Derived, typename Counter = SimpleCounter, typename Deleter = DefaultDelete>
+class WeakRefCounted : public RefCounted<Derived, Counter, ExpireWeakThen<Deleter>> {
+    using Base = RefCounted<Derived, Counter, ExpireWeakThen<Deleter>>;
+
+    template <typename D>
+    friend struct ExpireWeakThen;
+
+    template <typename T>
+    friend class IntrusiveWeakPtr;
+
+public:
+    WeakRefCounted() = default;
+
+    // Weak references observe the original, not the copy
+    WeakRefCounted(const WeakRefCounted& other) : Base(other) {
+    }
+
+    WeakRefCounted& operator=(const WeakRefCounted& other) {
+        Base::operator=(other);
+        return *this;
+    }
+
+    ~WeakRefCounted() {
+        ExpireWeakRefs();
+    }
+
+private:
+    // Caller holds a strong reference, so the object can't expire in the meantime
+    IntrusiveWeakToken* WeakToken() {
+        IntrusiveWeakToken* token = token_.load(std::memory_order_acquire);
+        if (!token) {
+            auto* fresh = new IntrusiveWeakToken();
+            if (token_.compare_exchange_strong(token, fresh, std::memory_order_acq_rel)) {
+                token = fresh;
+            } else {
+                delete fresh;
+            }
+        }
+        return token;
+    }
+
+    void ExpireWeakRefs() {
+        if (IntrusiveWeakToken* token = token_.exchange(nullptr, std::memory_order_acq_rel)) {
+            token->Expire();
+            token->Release();
+        }
+    }
+
+    std::atomic<IntrusiveWeakToken*> token_ = nullptr;
+};
+
+// Non-owning reference to an object derived from `WeakRefCounted`, `WeakPtr`-style
+template <typename T>
+class IntrusiveWeakPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    IntrusiveWeakPtr() = default;
+
+    IntrusiveWeakPtr(const IntrusivePtr<T>& ptr) : ptr_(ptr.Get()) {
+        if (ptr_) {
+            token_ = ptr_->WeakToken();
+            token_->AddRef();
+        }
+    }
+
+    IntrusiveWeakPtr(const IntrusiveWeakPtr& other) : ptr_(other.ptr_), token_(other.token_) {
+        if (token_) {
+            token_->AddRef();
+        }
+    }
+
+    IntrusiveWeakPtr(IntrusiveWeakPtr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), token_(std::exchange(other.token_, nullptr)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    IntrusiveWeakPtr& operator=(const IntrusiveWeakPtr& other) {
+        IntrusiveWeakPtr(other).Swap(*this);
+        return *this;
+    }
+
+    IntrusiveWeakPtr& operator=(IntrusiveWeakPtr&& other) noexcept {
+        IntrusiveWeakPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~IntrusiveWeakPtr() {
+        if (token_) {
+            token_->Release();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        IntrusiveWeakPtr().Swap(*this);
+    }
+
+    void Swap(IntrusiveWeakPtr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(token_, other.token_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    bool Expired() const {
+        return !token_ || !token_->Alive();
+    }
+
+    // Empty if the object is gone or going
+    IntrusivePtr<T> Lock() const {
+        if (token_ && token_->TryIncRef(ptr_)) {
+            return IntrusivePtr<T>(ptr_, AdoptRef{});
+        }
+        return nullptr;
+    }
+
+private:
+    T* ptr_ = nullptr;
+    IntrusiveWeakToken* token_ = nullptr;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusiveWeakPtr<T>> : std::true_type {};
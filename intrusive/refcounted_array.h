@@ -0,0 +1,105 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <common/array_bytes.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+
+// Runs the element destructors and frees header and elements together
+struct TrailingArrayDelete {
+    template <typename Array>
+    static void Destroy(Array* array) {
+        array->DestroyAndFree();
+    }
+};
+
+// Immutable-size array behind an intrusive counter: header, counter and elements
+// share one allocation. Made by `Create`, owned through `IntrusivePtr`
+template <typename Elem, typename Counter = SimpleCounter>
+class RefCountedArray
+    : public RefCounted<RefCountedArray<Elem, Counter>, Counter, TrailingArrayDelete> {
+    friend struct TrailingArrayDelete;
+
+public:
+    // `size` elements, each `Elem(args...)` (value-initialized without `args`). Throws
+    // `std::bad_array_new_length` if they do not fit in memory
+    template <typename... Args>
+    static IntrusivePtr<RefCountedArray> Create(size_t size, const Args&... args) {
+        void* memory = ::operator new(ArrayBytes(size, sizeof(Elem), ElementsOffset()),
+                                      std::align_val_t(Alignment()));
+        auto* array = new (memory) RefCountedArray(size);
+        Elem* elements = array->Data();
+        size_t built = 0;
+        try {
+            for (; built < size; ++built) {
+                new (elements + built) Elem(args...);
+            }
+        } catch (...) {
+            std::destroy_n(elements, built);
+            array->size_ = 0;
+            array->DestroyAndFree();
+            throw;
+        }
+        array->InitRefCount();
+        return IntrusivePtr<RefCountedArray>(array, AdoptRef{});
+    }
+
+    RefCountedArray(const RefCountedArray&) = delete;
+    RefCountedArray& operator=(const RefCountedArray&) = delete;
+
+    Elem* Data() {
+        return reinterpret_cast<Elem*>(reinterpret_cast<std::byte*>(this) + ElementsOffset());
+    }
+
+    const Elem* Data() const {
+        return reinterpret_cast<const Elem*>(reinterpret_cast<const std::byte*>(this) +
+                                             ElementsOffset());
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    Elem& operator[](size_t index) {
+        return Data()[index];
+    }
+
+    const Elem& operator[](size_t index) const {
+        return Data()[index];
+    }
+
+    std::span<Elem> Elements() {
+        return {Data(), size_};
+    }
+
+    std::span<const Elem> Elements() const {
+        return {Data(), size_};
+    }
+
+private:
+    explicit RefCountedArray(size_t size) : size_(size) {
+    }
+
+    ~RefCountedArray() = default;
+
+    static constexpr size_t Alignment() {
+        return std::max(alignof(RefCountedArray), alignof(Elem));
+    }
+
+    static constexpr size_t ElementsOffset() {
+        return (sizeof(RefCountedArray) + alignof(Elem) - 1) / alignof(Elem) * alignof(Elem);
+    }
+
+    void DestroyAndFree() {
+        std::destroy_n(Data(), size_);
+        this->~RefCountedArray();
+        ::operator delete(this, std::align_val_t(Alignment()));
+    }
+
+    size_t size_;
+};
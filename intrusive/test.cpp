@@ -1,10 +1,23 @@
 #include "intrusive.h"
+#include "destroy_policies.h"
+#include "intrusive_weak.h"
+#include "refcounted_array.h"
 
 #include <catch.hpp>
 
+#include <common/monotonic_arena.h>
+#include <common/relocating_vector.h>
+#include <shared-from-this/shared.h>
+#include <unique/unique.h>
+
 #include "allocations_checker.h"
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -386,3 +399,501 @@ TEST_CASE("Object pool") {
         REQUIRE(strs.NumInUse() == 1);
     }
 }
+
+TEST_CASE("Hash") {
+    std::unordered_set<IntrusivePtr<MyInt>> set;
+    auto a = MakeIntrusive<MyInt>(1);
+    set.insert(a);
+    set.insert(MakeIntrusive<MyInt>(2));
+    set.insert(a);
+    REQUIRE(set.size() == 2);
+    REQUIRE(a.UseCount() == 2);
+    REQUIRE(std::hash<IntrusivePtr<MyInt>>()(a) == MixPointer(a.Get()));
+}
+
+static_assert(std::is_nothrow_move_constructible_v<IntrusivePtr<MyInt>>);
+static_assert(std::is_nothrow_move_assignable_v<IntrusivePtr<MyInt>>);
+static_assert(kIsTriviallyRelocatable<IntrusivePtr<MyInt>>);
+
+static_assert(kIsTriviallyRelocatable<UniquePtr<MyInt>>);
+static_assert(kIsTriviallyRelocatable<SharedPtr<MyInt>>);
+
+// Counts every `IncRef` and `DecRef`, so a test can tell relocation from a copy followed
+// by destroying the original, which leaves the same count behind
+struct CountingCounter : SimpleCounter {
+    static inline int calls = 0;
+
+    size_t IncRef() {
+        ++calls;
+        return SimpleCounter::IncRef();
+    }
+
+    size_t DecRef() {
+        ++calls;
+        return SimpleCounter::DecRef();
+    }
+};
+
+struct Traced : RefCounted<Traced, CountingCounter, DefaultDelete> {
+    int value = 1;
+};
+
+// An `IntrusivePtr` whose move constructor is counted: a moved-from `IntrusivePtr` is null
+// and its destructor does nothing, so only this tells whether growing ran any moves
+struct CountedMove {
+    static inline int moves = 0;
+
+    explicit CountedMove(IntrusivePtr<Traced> ptr) : ptr(std::move(ptr)) {
+    }
+
+    CountedMove(CountedMove&& other) noexcept : ptr(std::move(other.ptr)) {
+        ++moves;
+    }
+
+    IntrusivePtr<Traced> ptr;
+};
+
+template <>
+struct IsTriviallyRelocatable<CountedMove> : std::true_type {};
+
+TEST_CASE("Relocating vector") {
+    auto a = MakeIntrusive<Traced>();
+    {
+        RelocatingVector<IntrusivePtr<Traced>> ptrs;
+        for (int i = 0; i < 100; ++i) {
+            ptrs.PushBack(a);
+        }
+        REQUIRE(a.UseCount() == 101);
+
+        // Growing moves the bytes: no reference count traffic
+        CountingCounter::calls = 0;
+        ptrs.Reserve(1000);
+        REQUIRE(ptrs.Capacity() == 1000);
+        REQUIRE(CountingCounter::calls == 0);
+
+        while (ptrs.Size() < ptrs.Capacity()) {
+            ptrs.PushBack(a);
+        }
+        auto extra = a;
+        CountingCounter::calls = 0;
+        ptrs.EmplaceBack(std::move(extra));
+        REQUIRE(ptrs.Capacity() == 2000);
+        REQUIRE(CountingCounter::calls == 0);
+
+        ptrs.EmplaceBack(ptrs[0]);
+        REQUIRE(CountingCounter::calls == 1);
+        REQUIRE(a.UseCount() == 1003);
+        for (auto& ptr : ptrs) {
+            REQUIRE(ptr->value == 1);
+        }
+    }
+    REQUIRE(a.UseCount() == 1);
+
+    {
+        RelocatingVector<CountedMove> refs;
+        for (int i = 0; i < 100; ++i) {
+            refs.EmplaceBack(a);
+        }
+        CountedMove::moves = 0;
+        refs.Reserve(1000);
+        REQUIRE(CountedMove::moves == 0);
+
+        while (refs.Size() < refs.Capacity()) {
+            refs.EmplaceBack(a);
+        }
+        CountedMove::moves = 0;
+        refs.EmplaceBack(CountedMove(a));
+        // Only the new element is moved, into a temporary and then into place
+        REQUIRE(refs.Capacity() == 2000);
+        REQUIRE(CountedMove::moves == 2);
+        REQUIRE(a.UseCount() == 1002);
+    }
+    REQUIRE(a.UseCount() == 1);
+}
+
+TEST_CASE("Refcounted array") {
+    SECTION("Shared elements") {
+        IntrusivePtr<RefCountedArray<std::string>> a;
+        EXPECT_ONE_ALLOCATION(a = RefCountedArray<std::string>::Create(3, "abc"));
+        auto b = a;
+        REQUIRE(a.UseCount() == 2);
+        REQUIRE(b->Size() == 3);
+        (*a)[1] = "def";
+        REQUIRE((*b)[1] == "def");
+        REQUIRE(b->Elements().back() == "abc");
+    }
+
+    SECTION("Destroys elements") {
+        CountedString::ResetCounters();
+        {
+            auto array = RefCountedArray<CountedString>::Create(10);
+            REQUIRE(CountedString::NumAlive() == 10);
+        }
+        REQUIRE(CountedString::NumAlive() == 0);
+    }
+
+    SECTION("Empty") {
+        auto array = RefCountedArray<int>::Create(0);
+        REQUIRE(array->Elements().empty());
+    }
+
+    SECTION("Too large") {
+        REQUIRE_THROWS_AS(RefCountedArray<uint64_t>::Create(SIZE_MAX / 8),
+                          std::bad_array_new_length);
+    }
+}
+
+struct SharedCounted : ThreadSafeRefCounted<SharedCounted> {
+    static inline std::atomic<int> destroyed = 0;
+
+    ~SharedCounted() {
+        ++destroyed;
+    }
+};
+
+TEST_CASE("Thread-safe counter") {
+    SECTION("Copies start unreferenced") {
+        auto a = MakeIntrusive<SharedCounted>();
+        SharedCounted copy(*a);
+        REQUIRE(a.UseCount() == 1);
+        REQUIRE(copy.RefCount() == 0);
+    }
+
+    SECTION("Concurrent copies") {
+        SharedCounted::destroyed = 0;
+        constexpr int kThreads = 4;
+        constexpr int kIterations = 10000;
+        for (int round = 0; round < 10; ++round) {
+            IntrusivePtr<SharedCounted> shared = MakeIntrusive<SharedCounted>();
+            std::vector<std::thread> threads;
+            for (int i = 0; i < kThreads; ++i) {
+                threads.emplace_back([copy = shared] {
+                    for (int j = 0; j < kIterations; ++j) {
+                        IntrusivePtr<SharedCounted> local = copy;
+                    }
+                });
+            }
+            shared.Reset();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            REQUIRE(SharedCounted::destroyed == round + 1);
+        }
+    }
+}
+
+struct Observed : WeakRefCounted<Observed, AtomicCounter> {
+    explicit Observed(int value) : value(value) {
+    }
+
+    int value;
+};
+
+// One token pointer on top of a plain refcounted object
+static_assert(sizeof(Observed) == sizeof(MyInt) + sizeof(void*));
+
+TEST_CASE("Intrusive weak pointers") {
+    SECTION("Lock") {
+        auto strong = MakeIntrusive<Observed>(5);
+        IntrusiveWeakPtr<Observed> weak = strong;
+        REQUIRE(!weak.Expired());
+        {
+            auto locked = weak.Lock();
+            REQUIRE(locked->value == 5);
+            REQUIRE(strong.UseCount() == 2);
+        }
+        REQUIRE(strong.UseCount() == 1);
+        strong.Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(!weak.Lock());
+    }
+
+    SECTION("Copies and empty") {
+        IntrusiveWeakPtr<Observed> empty;
+        REQUIRE(empty.Expired());
+        REQUIRE(!empty.Lock());
+
+        IntrusiveWeakPtr<Observed> a;
+        {
+            auto strong = MakeIntrusive<Observed>(1);
+            a = strong;
+            IntrusiveWeakPtr<Observed> b = a;
+            IntrusiveWeakPtr<Observed> c = std::move(b);
+            REQUIRE(c.Lock().Get() == strong.Get());
+            REQUIRE(b.Expired());
+        }
+        IntrusiveWeakPtr<Observed> d = a;
+        REQUIRE(d.Expired());
+        d.Reset();
+    }
+
+    SECTION("Racing the last release") {
+        for (int round = 0; round < 100; ++round) {
+            auto strong = MakeIntrusive<Observed>(round);
+            IntrusiveWeakPtr<Observed> weak = strong;
+            std::atomic<int> bad = 0;
+            std::thread locker([&bad, weak] {
+                for (int i = 0; i < 1000; ++i) {
+                    if (auto locked = weak.Lock(); locked && locked->value < 0) {
+                        ++bad;
+                    }
+                }
+            });
+            strong.Reset();
+            locker.join();
+            REQUIRE(bad == 0);
+            REQUIRE(weak.Expired());
+        }
+    }
+}
+
+struct SharedInt : public ThreadSafeRefCounted<SharedInt> {
+    SharedInt(int value) : value{value} {
+    }
+
+    int value = 0;
+};
+
+TEST_CASE("Adopt and detach") {
+    SECTION("Fresh objects start at one") {
+        auto a = MakeIntrusive<MyInt>(1);
+        REQUIRE(a.UseCount() == 1);
+        auto b = MakeIntrusive<SharedInt>(2);
+        REQUIRE(b.UseCount() == 1);
+    }
+
+    SECTION("Round trip through a raw pointer") {
+        auto a = MakeIntrusive<SharedInt>(3);
+        SharedInt* raw = a.Detach();
+        REQUIRE(!a);
+        REQUIRE(raw->RefCount() == 1);
+
+        IntrusivePtr<SharedInt> b(raw, AdoptRef{});
+        REQUIRE(b.UseCount() == 1);
+        REQUIRE(b->value == 3);
+    }
+
+    SECTION("Retain") {
+        auto a = MakeIntrusive<MyInt>(4);
+        IntrusivePtr<MyInt> b(a.Get(), RetainRef{});
+        REQUIRE(a.UseCount() == 2);
+        b.Reset();
+        REQUIRE(a.UseCount() == 1);
+    }
+
+    SECTION("Already counted object") {
+        auto* raw = new MyInt(5);
+        raw->IncRef();  // E.g. handed over by a C API
+        IntrusivePtr<MyInt> a(raw, AdoptRef{});
+        REQUIRE(a.UseCount() == 1);
+    }
+
+    SECTION("Detach empty") {
+        IntrusivePtr<MyInt> a;
+        REQUIRE(a.Detach() == nullptr);
+    }
+}
+
+struct PackedFields {
+    uint16_t tag;
+    uint32_t key;
+    void* next;
+};
+
+struct PackedNode : RefCounted<PackedNode, StickyCounter<uint16_t>, DefaultDelete> {
+    uint16_t tag = 0;
+    uint32_t key = 0;
+    void* next = nullptr;
+};
+
+struct WideNode : SimpleRefCounted<WideNode> {
+    uint16_t tag = 0;
+    uint32_t key = 0;
+    void* next = nullptr;
+};
+
+struct TinyShared : RefCounted<TinyShared, StickyAtomicCounter<uint8_t>, DefaultDelete> {
+    int value = 0;
+};
+
+TEST_CASE("Counter widths") {
+    SECTION("Packing") {
+        static_assert(sizeof(SimpleCounterOf<uint16_t>) == 2);
+        static_assert(sizeof(AtomicCounterOf<uint32_t>) == 4);
+        static_assert(kRefCountOverhead<PackedNode, PackedFields> == 0);
+        static_assert(kRefCountOverhead<WideNode, PackedFields> == sizeof(size_t));
+
+        auto node = MakeIntrusive<PackedNode>();
+        auto copy = node;
+        REQUIRE(node.UseCount() == 2);
+    }
+
+    SECTION("Unchecked narrow counter") {
+        SimpleCounterOf<uint8_t> counter;
+        counter.Init(254);
+        REQUIRE(counter.IncRef() == 255);
+        REQUIRE(counter.DecRef() == 254);
+    }
+
+    SECTION("Sticky") {
+        StickyCounter<uint8_t> counter;
+        counter.Init(1000);
+        REQUIRE(counter.RefCount() == 255);
+        REQUIRE(counter.DecRef() == 255);
+        REQUIRE(counter.IncRef() == 255);
+        REQUIRE(counter.TryIncRef());
+    }
+
+    SECTION("Sticky object is never destroyed") {
+        static TinyShared object;
+        std::vector<IntrusivePtr<TinyShared>> refs;
+        for (int i = 0; i < 300; ++i) {
+            refs.emplace_back(&object);
+        }
+        REQUIRE(object.RefCount() == 255);
+        refs.clear();
+        REQUIRE(object.RefCount() == 255);
+        REQUIRE(IntrusivePtr<TinyShared>(&object).UseCount() == 255);
+    }
+
+    SECTION("Concurrent sticky") {
+        auto object = MakeIntrusive<TinyShared>();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([object] {
+                for (int i = 0; i < 1000; ++i) {
+                    auto copy = object;
+                    std::vector<IntrusivePtr<TinyShared>> many(20, object);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(object.UseCount() == 1);
+    }
+}
+
+struct Singleton : RefCounted<Singleton, StickyAtomicCounter<uint32_t>, DefaultDelete> {
+    int value = 42;
+};
+
+TEST_CASE("Immortal") {
+    static Singleton singleton;
+    static const IntrusivePtr<Singleton> kSingleton = MakeImmortal(singleton);
+
+    REQUIRE(singleton.Immortal());
+    REQUIRE(kSingleton->value == 42);
+    {
+        auto copy = kSingleton;
+        IntrusivePtr<Singleton> raw(&singleton);
+        REQUIRE(kSingleton.UseCount() == StickyAtomicCounter<uint32_t>::kMax);
+    }
+    REQUIRE(singleton.TryIncRef());
+    singleton.DecRef();
+    REQUIRE(kSingleton.UseCount() == StickyAtomicCounter<uint32_t>::kMax);
+
+    auto mortal = MakeIntrusive<Singleton>();
+    REQUIRE(!mortal->Immortal());
+}
+
+struct PooledNode : RefCounted<PooledNode, SimpleCounter, ReturnToPool<IntrusivePool<PooledNode>>> {
+    PooledNode(int value, IntrusivePtr<PooledNode> next = nullptr)
+        : value(value), next(std::move(next)) {
+    }
+
+    int value;
+    IntrusivePtr<PooledNode> next;
+};
+
+struct ArenaNode : RefCounted<ArenaNode, SimpleCounter, ArenaDestroy> {
+    explicit ArenaNode(int& destroyed) : destroyed(destroyed) {
+    }
+
+    ~ArenaNode() {
+        ++destroyed;
+    }
+
+    int& destroyed;
+};
+
+DeferredReclaimer deferred_reclaimer;
+
+struct DeferredNode
+    : RefCounted<DeferredNode, AtomicCounter, DeferredDestroy<StaticHome<deferred_reclaimer>>> {
+    static inline std::atomic<int> destroyed = 0;
+
+    ~DeferredNode() {
+        ++destroyed;
+    }
+};
+
+TEST_CASE("Destroy policies") {
+    SECTION("Return to pool") {
+        struct SameFields {
+            size_t count;
+            int value;
+            void* next;
+        };
+        static_assert(sizeof(PooledNode) == sizeof(SameFields));  // No home pointer
+
+        IntrusivePool<PooledNode> first;
+        IntrusivePool<PooledNode> second;
+        auto a = first.Make(1);
+        auto b = second.Make(2, first.Make(3));
+        REQUIRE(a.UseCount() == 1);
+        REQUIRE(&IntrusivePool<PooledNode>::HomeOf(a.Get()) == &first);
+        REQUIRE(&IntrusivePool<PooledNode>::HomeOf(b.Get()) == &second);
+        REQUIRE(first.NumInUse() == 2);
+
+        a.Reset();
+        REQUIRE(first.NumInUse() == 1);
+        b.Reset();
+        REQUIRE(first.NumInUse() == 0);
+        REQUIRE(second.NumInUse() == 0);
+
+        // Released slots are reused
+        EXPECT_ZERO_ALLOCATIONS(auto c = first.Make(4); auto d = first.Make(5););
+        REQUIRE(first.NumSlabs() == 1);
+    }
+
+    SECTION("Many slabs") {
+        IntrusivePool<PooledNode> pool;
+        std::vector<IntrusivePtr<PooledNode>> nodes;
+        for (int i = 0; i < 10000; ++i) {
+            nodes.push_back(pool.Make(i));
+        }
+        REQUIRE(pool.NumSlabs() > 1);
+        for (const auto& node : nodes) {
+            REQUIRE(&IntrusivePool<PooledNode>::HomeOf(node.Get()) == &pool);
+        }
+        nodes.clear();
+        REQUIRE(pool.NumInUse() == 0);
+    }
+
+    SECTION("Arena") {
+        MonotonicArena arena;
+        int destroyed = 0;
+        {
+            auto a = MakeArenaIntrusive<ArenaNode>(arena, destroyed);
+            auto b = a;
+            REQUIRE(a.UseCount() == 2);
+        }
+        REQUIRE(destroyed == 1);
+        REQUIRE(arena.ChunkCount() == 1);
+    }
+
+    SECTION("Deferred") {
+        DeferredNode::destroyed = 0;
+        auto a = MakeIntrusive<DeferredNode>();
+        std::thread dropper([a]() mutable { a.Reset(); });
+        dropper.join();
+        REQUIRE(deferred_reclaimer.NumPending() == 0);
+        a.Reset();
+        REQUIRE(DeferredNode::destroyed == 0);
+        REQUIRE(deferred_reclaimer.NumPending() == 1);
+        REQUIRE(deferred_reclaimer.Reclaim() == 1);
+        REQUIRE(DeferredNode::destroyed == 1);
+        REQUIRE(deferred_reclaimer.Reclaim() == 0);
+    }
+}
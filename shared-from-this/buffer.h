@@ -0,0 +1,274 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// View of `size` bytes of a refcounted block. Copies and slices share the block: the
+// pointer aliases the block's control block, so no bytes are copied and the block is
+// freed with the last view
+class SharedBuffer {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SharedBuffer() = default;
+
+    SharedBuffer(SharedPtr<std::byte> data, size_t size) : data_(std::move(data)), size_(size) {
+    }
+
+    // Block and bytes in one allocation, contents uninitialized
+    static SharedBuffer Allocate(size_t size) {
+        return {MakeSharedBytes(size), size};
+    }
+
+    static SharedBuffer Copy(std::span<const std::byte> bytes) {
+        SharedBuffer buffer = Allocate(bytes.size());
+        if (!bytes.empty()) {
+            std::memcpy(buffer.MutableData(), bytes.data(), bytes.size());
+        }
+        return buffer;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Slicing
+
+    // Throws `std::out_of_range` if the range doesn't fit
+    SharedBuffer Slice(size_t offset, size_t size) const {
+        if (offset > size_ || size > size_ - offset) {
+            throw std::out_of_range("SharedBuffer::Slice");
+        }
+        return {SharedPtr<std::byte>(data_, data_.Get() + offset), size};
+    }
+
+    // Cuts off and returns the first `size` bytes
+    SharedBuffer SplitFront(size_t size) {
+        SharedBuffer front = Slice(0, size);
+        *this = Slice(size, size_ - size);
+        return front;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const std::byte* Data() const {
+        return data_.Get();
+    }
+
+    // Writable while the bytes are being filled, before the buffer is shared
+    std::byte* MutableData() {
+        return data_.Get();
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    std::span<const std::byte> Bytes() const {
+        return {data_.Get(), size_};
+    }
+
+    size_t UseCount() const {
+        return data_.UseCount();
+    }
+
+private:
+    SharedPtr<std::byte> data_;
+    size_t size_ = 0;
+};
+
+// Sequence of `SharedBuffer`s read and written as one byte stream. Splitting, slicing and
+// appending move views around and never copy payload bytes
+class BufferChain {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Append(SharedBuffer buffer) {
+        if (!buffer.Empty()) {
+            size_ += buffer.Size();
+            buffers_.push_back(std::move(buffer));
+        }
+    }
+
+    void Append(BufferChain other) {
+        for (auto& buffer : other.buffers_) {
+            Append(std::move(buffer));
+        }
+    }
+
+    // Cuts off and returns the first `size` bytes. Throws `std::out_of_range` if there
+    // are fewer
+    BufferChain SplitFront(size_t size) {
+        if (size > size_) {
+            throw std::out_of_range("BufferChain::SplitFront");
+        }
+        BufferChain front;
+        while (!buffers_.empty() && buffers_.front().Size() <= size - front.size_) {
+            front.Append(std::move(buffers_.front()));
+            buffers_.pop_front();
+        }
+        if (front.size_ < size) {
+            front.Append(buffers_.front().SplitFront(size - front.size_));
+        }
+        size_ -= size;
+        return front;
+    }
+
+    // Like `SplitFront`, without building the front chain
+    void DropFront(size_t size) {
+        if (size > size_) {
+            throw std::out_of_range("BufferChain::DropFront");
+        }
+        size_ -= size;
+        while (size > 0 && buffers_.front().Size() <= size) {
+            size -= buffers_.front().Size();
+            buffers_.pop_front();
+        }
+        if (size > 0) {
+            buffers_.front().SplitFront(size);
+        }
+    }
+
+    // Throws `std::out_of_range` if the range doesn't fit
+    BufferChain Slice(size_t offset, size_t size) const {
+        if (offset > size_ || size > size_ - offset) {
+            throw std::out_of_range("BufferChain::Slice");
+        }
+        BufferChain slice;
+        for (const auto& buffer : buffers_) {
+            if (slice.size_ == size) {
+                break;
+            }
+            if (offset >= buffer.Size()) {
+                offset -= buffer.Size();
+                continue;
+            }
+            size_t take = std::min(buffer.Size() - offset, size - slice.size_);
+            slice.Append(buffer.Slice(offset, take));
+            offset = 0;
+        }
+        return slice;
+    }
+
+    void Clear() {
+        buffers_.clear();
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Scatter-gather I/O
+
+    // Writes as much as `fd` accepts, at most `IOV_MAX` buffers per `writev`, and drops the
+    // written bytes from the front. Stops early on a non-blocking `fd` that would block.
+    // Returns the number of bytes written, throws `std::system_error` on other errors
+    size_t WriteTo(int fd) {
+        size_t total = 0;
+        std::vector<iovec> iov;
+        iov.reserve(std::min<size_t>(buffers_.size(), IOV_MAX));
+        while (size_ > 0) {
+            iov.clear();
+            for (size_t i = 0; i < buffers_.size() && i < IOV_MAX; ++i) {
+                iov.push_back({const_cast<std::byte*>(buffers_[i].Data()), buffers_[i].Size()});
+            }
+            ssize_t written = writev(fd, iov.data(), static_cast<int>(iov.size()));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                throw std::system_error(errno, std::generic_category(), "writev");
+            }
+            DropFront(static_cast<size_t>(written));
+            total += static_cast<size_t>(written);
+        }
+        return total;
+    }
+
+    // One `readv` of up to `size` bytes into fresh blocks of `block_size`, appended
+    // to the chain. Returns the number of bytes read, 0 at end of file. Every block is
+    // allocated before the read: blocks left empty are freed, and a last block filled to
+    // less than a quarter is copied into one that fits, so a short read doesn't pin a
+    // whole block for a few bytes. Throws `std::invalid_argument` if `block_size` is 0
+    size_t ReadFrom(int fd, size_t size, size_t block_size = 64 << 10) {
+        if (block_size == 0) {
+            throw std::invalid_argument("BufferChain::ReadFrom");
+        }
+        std::vector<SharedBuffer> blocks;
+        std::vector<iovec> iov;
+        for (size_t left = size; left > 0 && iov.size() < IOV_MAX;) {
+            size_t block = std::min(left, block_size);
+            blocks.push_back(SharedBuffer::Allocate(block));
+            iov.push_back({blocks.back().MutableData(), block});
+            left -= block;
+        }
+        ssize_t received;
+        do {
+            received = readv(fd, iov.data(), static_cast<int>(iov.size()));
+        } while (received < 0 && errno == EINTR);
+        if (received < 0) {
+            throw std::system_error(errno, std::generic_category(), "readv");
+        }
+        size_t left = static_cast<size_t>(received);
+        for (auto& block : blocks) {
+            size_t take = std::min(left, block.Size());
+            if (take < block.Size() / 4) {
+                Append(SharedBuffer::Copy(block.Bytes().first(take)));
+            } else {
+                Append(block.SplitFront(take));
+            }
+            left -= take;
+        }
+        return static_cast<size_t>(received);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    const std::deque<SharedBuffer>& Buffers() const {
+        return buffers_;
+    }
+
+    // Copies the payload out: for consumers that need contiguous bytes
+    std::vector<std::byte> Flatten() const {
+        std::vector<std::byte> bytes;
+        bytes.reserve(size_);
+        for (const auto& buffer : buffers_) {
+            bytes.insert(bytes.end(), buffer.Bytes().begin(), buffer.Bytes().end());
+        }
+        return bytes;
+    }
+
+private:
+    // A deque, so dropping written buffers from the front doesn't shift the rest
+    std::deque<SharedBuffer> buffers_;
+    size_t size_ = 0;
+};
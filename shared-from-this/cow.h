@@ -0,0 +1,78 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <utility>
+
+// Copy-on-write value: copies share one object until somebody asks for mutable access.
+// A shared object is cloned on the first such access, a unique one is modified in place
+template <typename T>
+class CowPtr {
+    template <typename Y, typename... Args>
+    friend CowPtr<Y> MakeCow(Args&&... args);
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    CowPtr() = default;
+
+    explicit CowPtr(const T& value) : ptr_(MakeShared<T>(value)) {
+    }
+
+    explicit CowPtr(T&& value) : ptr_(MakeShared<T>(std::move(value))) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Shared read access
+
+    const T* Get() const {
+        return ptr_.Get();
+    }
+
+    const T& operator*() const {
+        return *ptr_;
+    }
+
+    const T* operator->() const {
+        return ptr_.Get();
+    }
+
+    // The returned pointer counts as one more owner: the next `Mutable()` clones,
+    // and the holder keeps seeing the old value
+    SharedPtr<const T> Share() const {
+        return ptr_;
+    }
+
+    size_t UseCount() const {
+        return ptr_.UseCount();
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(ptr_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Mutable access
+
+    // Must not be called on an empty pointer.
+    // The reference is invalidated by copying this `CowPtr`: the copy would see the writes
+    T& Mutable() {
+        if (!ptr_.IsUnique()) {
+            ptr_ = MakeShared<T>(std::as_const(*ptr_));
+        }
+        return *ptr_;
+    }
+
+private:
+    explicit CowPtr(SharedPtr<T> ptr) : ptr_(std::move(ptr)) {
+    }
+
+    SharedPtr<T> ptr_;
+};
+
+template <typename T, typename... Args>
+CowPtr<T> MakeCow(Args&&... args) {
+    return CowPtr<T>(MakeShared<T>(std::forward<Args>(args)...));
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+#include "weak.h"
+
+#include <common/pointer_hash.h>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+// Side table keyed by object identity. Keys are held weakly, so attaching a value doesn't
+// keep the key alive, and an entry disappears as soon as its key expires.
+// Entries are found by control block, not by `Get()`: aliased pointers to the same object
+// share one entry
+template <typename K, typename V>
+class EphemeronMap {
+public:
+    EphemeronMap() : state_(MakeShared<State>()) {
+    }
+
+    EphemeronMap(const EphemeronMap&) = delete;
+    EphemeronMap& operator=(const EphemeronMap&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Insert or assign. The reference stays valid while the caller holds `key`
+    // and nobody erases the entry
+    V& Insert(const SharedPtr<K>& key, V value) {
+        if (!key) {
+            throw std::invalid_argument("EphemeronMap key must not be empty");
+        }
+        const ControlBlockBase* block = key.control_block_;
+        std::optional<V> old;  // Destroyed after the lock is released
+        V* result;
+        bool fresh;
+        {
+            std::lock_guard lock(state_->mutex);
+            auto [it, inserted] = state_->entries.try_emplace(block, key);
+            Entry& entry = it->second;
+            if (entry.value) {
+                old.emplace(std::move(*entry.value));
+                entry.value.reset();
+            } else {
+                ++state_->size;
+            }
+            entry.value.emplace(std::move(value));
+            result = &*entry.value;
+            fresh = inserted;
+        }
+        // One hook per key for the map's lifetime: an entry that is erased and inserted again
+        // reuses its slot and its hook
+        if (fresh) {
+            key.OnExpire([state = WeakPtr<State>(state_), block] {
+                if (auto alive = state.Lock()) {
+                    alive->Expire(block);
+                }
+            });
+        }
+        return *result;
+    }
+
+    bool Erase(const SharedPtr<K>& key) {
+        return state_->Erase(key.control_block_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Lookup
+
+    // Same validity rules as for `Insert`
+    V* Find(const SharedPtr<K>& key) const {
+        std::lock_guard lock(state_->mutex);
+        auto it = state_->entries.find(key.control_block_);
+        if (it == state_->entries.end() || !it->second.value) {
+            return nullptr;
+        }
+        return &*it->second.value;
+    }
+
+    size_t Size() const {
+        std::lock_guard lock(state_->mutex);
+        return state_->size;
+    }
+
+private:
+    // Stays in the table until the key expires, even when erased: it remembers that the
+    // key's expiry hook is registered, and its `WeakPtr` pins the control block, so the
+    // block's address can't be reused by another key while the hook may still run
+    struct Entry {
+        explicit Entry(const SharedPtr<K>& key) : key(key) {
+        }
+
+        WeakPtr<K> key;
+        std::optional<V> value;
+    };
+
+    struct State {
+        using Entries = std::unordered_map<const ControlBlockBase*, Entry, PointerHash>;
+
+        bool Erase(const ControlBlockBase* block) {
+            std::optional<V> dead;
+            {
+                std::lock_guard lock(mutex);
+                auto it = entries.find(block);
+                if (it == entries.end() || !it->second.value) {
+                    return false;
+                }
+                dead.emplace(std::move(*it->second.value));
+                it->second.value.reset();
+                --size;
+            }
+            // `dead` is destroyed here, outside the lock
+            return true;
+        }
+
+        // Run by the key's expiry hook. Checks that the entry's key is the one that expired
+        void Expire(const ControlBlockBase* block) {
+            typename Entries::node_type dead;
+            {
+                std::lock_guard lock(mutex);
+                auto it = entries.find(block);
+                if (it == entries.end() || !it->second.key.Expired()) {
+                    return;
+                }
+                if (it->second.value) {
+                    --size;
+                }
+                dead = entries.extract(it);
+            }
+            // `dead` is destroyed here, outside the lock
+        }
+
+        mutable std::mutex mutex;
+        Entries entries;
+        size_t size = 0;  // Entries holding a value
+    };
+
+    SharedPtr<State> state_;
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <unique/unique.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// Access patterns passed to `madvise`
+enum class MappingAdvice {
+    kNormal = MADV_NORMAL,
+    kSequential = MADV_SEQUENTIAL,
+    kRandom = MADV_RANDOM,
+    kWillNeed = MADV_WILLNEED,
+    kDontNeed = MADV_DONTNEED,
+};
+
+// `madvise` wants a page-aligned start, so the range is widened to whole pages.
+// Advice is only a hint: failures are ignored
+inline void AdviseMapping(const std::byte* data, size_t size, MappingAdvice advice) {
+    if (!data || size == 0) {
+        return;
+    }
+    auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+    auto end = reinterpret_cast<uintptr_t>(data) + size;
+    madvise(reinterpret_cast<void*>(begin), end - begin, static_cast<int>(advice));
+}
+
+// Unmaps a whole mapping, so it carries the length
+class MmapDeleter {
+public:
+    MmapDeleter() = default;
+
+    explicit MmapDeleter(size_t size) : size_(size) {
+    }
+
+    void operator()(const std::byte* data) const {
+        if (data) {
+            munmap(const_cast<std::byte*>(data), size_);
+        }
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    size_t size_ = 0;
+};
+
+// Read-only bytes of a mapping, kept alive by a `SharedPtr` that aliases the mapping's
+// control block: slicing copies nothing, and the file is unmapped with the last slice
+class MappedSlice {
+public:
+    MappedSlice() = default;
+
+    MappedSlice(SharedPtr<const std::byte> data, size_t size)
+        : data_(std::move(data)), size_(size) {
+    }
+
+    // Throws `std::out_of_range` if the range doesn't fit
+    MappedSlice Sub(size_t offset, size_t size) const {
+        if (offset > size_ || size > size_ - offset) {
+            throw std::out_of_range("MappedSlice::Sub");
+        }
+        return {SharedPtr<const std::byte>(data_, data_.Get() + offset), size};
+    }
+
+    void Advise(MappingAdvice advice) const {
+        AdviseMapping(data_.Get(), size_, advice);
+    }
+
+    const std::byte* Data() const {
+        return data_.Get();
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    std::span<const std::byte> Bytes() const {
+        return {data_.Get(), size_};
+    }
+
+    // Slices of one mapping share one reference count
+    size_t UseCount() const {
+        return data_.UseCount();
+    }
+
+private:
+    SharedPtr<const std::byte> data_;
+    size_t size_ = 0;
+};
+
+// Read-only private mapping of a whole file, owned by a `UniquePtr`
+class MappedFile {
+public:
+    using Mapping = UniquePtr<const std::byte[], MmapDeleter>;
+
+    MappedFile() = default;
+
+    explicit MappedFile(Mapping mapping) : mapping_(std::move(mapping)) {
+    }
+
+    // Throws `std::system_error` if the file can't be opened or mapped
+    static MappedFile Open(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat " + path);
+        }
+        auto size = static_cast<size_t>(info.st_size);
+        if (size == 0) {
+            // `mmap` rejects empty ranges
+            close(fd);
+            return MappedFile();
+        }
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        close(fd);  // The mapping keeps the file referenced
+        if (data == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "mmap " + path);
+        }
+        return MappedFile(Mapping(static_cast<const std::byte*>(data), MmapDeleter(size)));
+    }
+
+    void Advise(MappingAdvice advice) const {
+        AdviseMapping(Data(), Size(), advice);
+    }
+
+    const std::byte* Data() const {
+        return mapping_.Get();
+    }
+
+    // 0 once the mapping has been moved out: a moved-from deleter still carries the length
+    size_t Size() const {
+        return mapping_ ? mapping_.GetDeleter().Size() : 0;
+    }
+
+    std::span<const std::byte> Bytes() const {
+        return {Data(), Size()};
+    }
+
+    // Hands the mapping over to shared ownership: one control block for all its slices
+    MappedSlice Share() && {
+        size_t size = Size();
+        const std::byte* data = mapping_.Release();
+        mapping_.GetDeleter() = MmapDeleter();
+        if (!data) {
+            return {};
+        }
+        return {SharedPtr<const std::byte>(data, MmapDeleter(size)), size};
+    }
+
+private:
+    Mapping mapping_;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <common/monotonic_arena.h>
+
+#include <type_traits>
+#include <utility>
+
+// Objects allocated together in a bump arena and owned together: every `SharedPtr` handed
+// out aliases the region's own control block, so thousands of objects cost one block and
+// one reference count. The region (all objects, then the arena) dies with the last handle.
+// Handles may be copied across threads; `Make` itself is not thread-safe
+class SharedRegion {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit SharedRegion(size_t initial_chunk_size = 4096)
+        : state_(MakeShared<State>(initial_chunk_size)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    template <typename T, typename... Args>
+    SharedPtr<T> Make(Args&&... args) {
+        State& state = *state_;
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            T* object = new (state.arena.Allocate<T>()) T(std::forward<Args>(args)...);
+            return SharedPtr<T>(state_, object);
+        } else {
+            // Every allocation is done before the object exists, so nothing can throw between
+            // its construction and its finalizer being linked in. If the constructor throws,
+            // the finalizer slot is left unused in the arena
+            auto* finalizer = state.arena.Allocate<Finalizer>();
+            void* storage = state.arena.Allocate<T>();
+            T* object = new (storage) T(std::forward<Args>(args)...);
+            *finalizer = {state.finalizers, object, [](void* ptr) { static_cast<T*>(ptr)->~T(); }};
+            state.finalizers = finalizer;
+            return SharedPtr<T>(state_, object);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Handles plus copies of the region itself
+    size_t UseCount() const {
+        return state_.UseCount();
+    }
+
+private:
+    struct Finalizer {
+        Finalizer* next;
+        void* object;
+        void (*destroy)(void* object);
+    };
+
+    struct State {
+        explicit State(size_t initial_chunk_size) : arena(initial_chunk_size) {
+        }
+
+        // Reverse order of creation, like locals
+        ~State() {
+            for (Finalizer* finalizer = finalizers; finalizer; finalizer = finalizer->next) {
+                finalizer->destroy(finalizer->object);
+            }
+        }
+
+        MonotonicArena arena;
+        Finalizer* finalizers = nullptr;
+    };
+
+    SharedPtr<State> state_;
+};
@@ -2,7 +2,10 @@
 
 #include "sw_fwd.h"  // Forward declaration
 #include "weak.h"
+#include <common/pointer_hash.h>
+#include <common/relocatable.h>
 #include <cstddef>  // std::nullptr_t
+#include <functional>
 #include <type_traits>
 #include <iostream>
 
@@ -17,6 +20,9 @@ class SharedPtr {
     template <typename Y>
     friend class WeakPtr;
 
+    template <typename K, typename V>
+    friend class EphemeronMap;
+
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -28,28 +34,27 @@ public:
     SharedPtr(std::nullptr_t) : control_block_(nullptr) {
     }
 
-    explicit SharedPtr(T* ptr) : control_block_(new ControlBlockPointer<T>(ptr)) {
-        ptr_ = ptr;
-        if constexpr (std::is_convertible_v<T*, EFSTBase*>) {
-            ptr->weak_this_ = *this;
-        }
+    explicit SharedPtr(T* ptr) : SharedPtr(ptr, std::default_delete<T>()) {
     }
 
     template <class Y>
-    SharedPtr(Y* ptr) : control_block_(new ControlBlockPointer<Y>(ptr)) {
-        ptr_ = ptr;
-        if constexpr (std::is_convertible_v<Y*, EFSTBase*>) {
-            ptr->weak_this_ = *this;
-        }
+    SharedPtr(Y* ptr) : SharedPtr(ptr, std::default_delete<Y>()) {
+    }
+
+    // `deleter(ptr)` runs when the last strong reference goes away, and right away
+    // if the control block can't be allocated
+    template <class Y, class Deleter, class Alloc = std::allocator<std::remove_cv_t<Y>>>
+    SharedPtr(Y* ptr, Deleter deleter, const Alloc& alloc = Alloc())
+        : ptr_(ptr), control_block_(MakeBlock(ptr, std::move(deleter), alloc)) {
+        EnableSharedFromThisFor(ptr);
     }
 
+    // Copies and moves never write to the object: `weak_this_` is set once, when the
+    // object gets its owner, so copies can be made concurrently
     SharedPtr(const SharedPtr<T>& other) : control_block_(other.control_block_), ptr_(other.ptr_) {
         if (control_block_) {
             control_block_->AddReference();
         }
-        if constexpr (std::is_convertible_v<T*, EFSTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
     }
 
     template <class Y>
@@ -57,38 +62,38 @@ public:
         if (control_block_) {
             control_block_->AddReference();
         }
-        if constexpr (std::is_convertible_v<Y*, EFSTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
     }
 
     template <class Y>
-    SharedPtr(SharedPtr<Y>&& other) {
+    SharedPtr(SharedPtr<Y>&& other) noexcept {
         control_block_ = other.control_block_;
         ptr_ = other.ptr_;
-        if constexpr (std::is_convertible_v<Y*, EFSTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
         other.control_block_ = nullptr;
         other.ptr_ = nullptr;
     }
 
-    SharedPtr(SharedPtr&& other) {
+    SharedPtr(SharedPtr&& other) noexcept {
         control_block_ = other.control_block_;
         ptr_ = other.ptr_;
-        if constexpr (std::is_convertible_v<T*, EFSTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
         other.control_block_ = nullptr;
         other.ptr_ = nullptr;
     }
 
-    template <class Y>
-    SharedPtr(ControlBlockHolder<Y>* block) : control_block_(block) {
+    template <class Y, class Alloc>
+    SharedPtr(ControlBlockHolder<Y, Alloc>* block) : control_block_(block) {
         ptr_ = block->GetPointer();
-        if constexpr (std::is_convertible_v<T*, EFSTBase*>) {
-            ptr_->weak_this_ = *this;
-        }
+        EnableSharedFromThisFor(ptr_);
+    }
+
+    template <class Y, class Elem>
+    SharedPtr(ControlBlockTrailing<Y, Elem>* block)
+        : ptr_(block->GetPointer()), control_block_(block) {
+        EnableSharedFromThisFor(ptr_);
+    }
+
+    SharedPtr(ControlBlockBytes* block)
+        requires std::is_same_v<std::remove_cv_t<T>, std::byte>
+        : ptr_(block->Data()), control_block_(block) {
     }
 
     // Aliasing constructor
@@ -103,12 +108,11 @@ public:
     // Promote `WeakPtr`
     // #11 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.control_block_->GetRefCounter() == 0) {
+        if (!other.control_block_ || !other.control_block_->TryAddReference()) {
             throw BadWeakPtr();
         }
         control_block_ = other.control_block_;
         ptr_ = other.ptr_;
-        control_block_->AddReference();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -127,7 +131,7 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr&& other) {
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
         if (this == &other) {
             return *this;
         }
@@ -156,19 +160,20 @@ public:
     }
 
     void Reset(T* ptr) {
-        TryToDeleteBlock();
-        control_block_ = new ControlBlockPointer<T>(ptr);
-        ptr_ = ptr;
+        SharedPtr(ptr).Swap(*this);
     }
 
     template <class Y>
     void Reset(Y* ptr) {
-        TryToDeleteBlock();
-        control_block_ = new ControlBlockPointer<Y>(ptr);
-        ptr_ = ptr;
+        SharedPtr(ptr).Swap(*this);
+    }
+
+    template <class Y, class Deleter, class Alloc = std::allocator<std::remove_cv_t<Y>>>
+    void Reset(Y* ptr, Deleter deleter, const Alloc& alloc = Alloc()) {
+        SharedPtr(ptr, std::move(deleter), alloc).Swap(*this);
     }
 
-    void Swap(SharedPtr& other) {
+    void Swap(SharedPtr& other) noexcept {
         std::swap(control_block_, other.control_block_);
         std::swap(ptr_, other.ptr_);
     }
@@ -197,23 +202,95 @@ public:
         return control_block_ != nullptr;
     }
 
+    // Nobody else holds a `SharedPtr` or a `WeakPtr` to the object, so it is safe
+    // to modify without synchronization. The object's own `weak_this_` doesn't count
+    // when `T` derives from `EnableSharedFromThis`; through a base that doesn't, it does
+    bool IsUnique() const {
+        if (!control_block_) {
+            return false;
+        }
+        size_t own_weak_refs = 0;
+        if constexpr (std::is_convertible_v<T*, const EFSTBase*>) {
+            if (ptr_ && ptr_->weak_this_.control_block_ == control_block_) {
+                own_weak_refs = 1;
+            }
+        }
+        return control_block_->IsUnique(own_weak_refs);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Owner-based comparison
+    // https://en.cppreference.com/w/cpp/memory/shared_ptr/owner_before
+
+    template <class Y>
+    bool OwnerBefore(const SharedPtr<Y>& other) const {
+        return std::less<const ControlBlockBase*>()(control_block_, other.control_block_);
+    }
+
+    template <class Y>
+    bool OwnerBefore(const WeakPtr<Y>& other) const {
+        return std::less<const ControlBlockBase*>()(control_block_, other.control_block_);
+    }
+
+    template <class Y>
+    bool OwnerEqual(const SharedPtr<Y>& other) const {
+        return control_block_ == other.control_block_;
+    }
+
+    template <class Y>
+    bool OwnerEqual(const WeakPtr<Y>& other) const {
+        return control_block_ == other.control_block_;
+    }
+
+    size_t OwnerHash() const {
+        return MixPointer(control_block_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Expiry notification
+
+    // `callback` runs once, right after the last strong reference destroys the object,
+    // on the releasing thread. Empty pointer has nothing to wait for, so it runs immediately
+    void OnExpire(ExpiryHooks::Callback callback) const {
+        if (!control_block_) {
+            callback();
+            return;
+        }
+        control_block_->AddExpiryCallback(std::move(callback));
+    }
+
+    template <typename Token>
+    void OnExpire(ExpiryQueue<Token>& queue, Token token) const {
+        OnExpire([&queue, token = std::move(token)]() mutable { queue.Push(std::move(token)); });
+    }
+
 private:
+    template <class Y, class Deleter, class Alloc>
+    static ControlBlockBase* MakeBlock(Y* ptr, Deleter deleter, const Alloc& alloc) {
+        try {
+            return AllocateControlBlock<ControlBlockPointer<Y, Deleter, Alloc>>(alloc, ptr, deleter,
+                                                                                alloc);
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+    }
+
     void TryToDeleteBlock() {
         if (control_block_) {
-            if (control_block_->GetWeakRefCounter() == 0 && control_block_->GetRefCounter() == 1) {
-                control_block_->DeleteT();
-                delete control_block_;
-                return;
-            }
-            if (control_block_->GetWeakRefCounter() > 0 && control_block_->GetRefCounter() == 1) {
-                control_block_->RemoveReference();
-                control_block_->DeleteT();
-                return;
-            }
             control_block_->RemoveReference();
         }
     }
 
+    template <class Y>
+    void EnableSharedFromThisFor(Y* ptr) {
+        if constexpr (std::is_convertible_v<Y*, EFSTBase*>) {
+            if (ptr) {
+                ptr->weak_this_ = *this;
+            }
+        }
+    }
+
     T* ptr_ = nullptr;
     ControlBlockBase* control_block_;
 };
@@ -223,10 +300,50 @@ inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
     return left.Get() == right.Get();
 }
 
-// Allocate memory only once
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
+template <typename T>
+struct std::hash<SharedPtr<T>> {
+    size_t operator()(const SharedPtr<T>& ptr) const {
+        return MixPointer(ptr.Get());
+    }
+};
+
+// Allocate memory only once, through `alloc`
+template <typename T, typename Alloc, typename... Args>
+SharedPtr<T> AllocateShared(const Alloc& alloc, Args&&... args) {
+    using Holder = ControlBlockHolder<T, Alloc>;
+    return SharedPtr<T>(AllocateControlBlock<Holder>(alloc, std::allocator_arg, alloc,
+                                                     std::forward<Args>(args)...));
+}
+
 template <typename T, typename... Args>
 SharedPtr<T> MakeShared(Args&&... args) {
-    return SharedPtr<T>(new ControlBlockHolder<T>(std::forward<Args>(args)...));
+    return AllocateShared<T>(std::allocator<std::remove_cv_t<T>>(), std::forward<Args>(args)...);
+}
+
+// For singletons and interned constants: built once, never destroyed, and copies of the
+// result never touch the reference count. Meant to initialize a `static`
+template <typename T, typename... Args>
+SharedPtr<T> MakeImmortal(Args&&... args) {
+    using Alloc = std::allocator<std::remove_cv_t<T>>;
+    auto* block = AllocateControlBlock<ControlBlockHolder<T, Alloc>>(
+        Alloc(), std::allocator_arg, Alloc(), std::forward<Args>(args)...);
+    block->MakeImmortal();
+    return SharedPtr<T>(block);
+}
+
+// `size` uninitialized bytes sharing one allocation with the control block
+inline SharedPtr<std::byte> MakeSharedBytes(size_t size) {
+    return SharedPtr<std::byte>(ControlBlockBytes::Create(size));
+}
+
+// `T(std::span<Elem>(elements, size), args...)` followed by `size` value-initialized
+// elements, sharing one allocation with the control block: a header with a flexible array
+template <typename T, typename Elem, typename... Args>
+SharedPtr<T> MakeSharedWithTrailing(size_t size, Args&&... args) {
+    return SharedPtr<T>(ControlBlockTrailing<T, Elem>::Create(size, std::forward<Args>(args)...));
 }
 
 // Look for usage examples in tests and seminar
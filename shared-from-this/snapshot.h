@@ -0,0 +1,109 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+// Read-mostly value published RCU-style: writers replace the whole value, readers keep
+// using the version they hold until they notice a newer one.
+// A version is destroyed once the last reader that holds it moves on
+template <typename T>
+class Snapshot {
+public:
+    // Cached view of a `Snapshot` for one thread (e.g. `thread_local`), not thread-safe itself.
+    // While the version doesn't change, reading is one atomic load: no locks and no
+    // reference counting
+    class Reader {
+    public:
+        explicit Reader(const Snapshot& source) : source_(&source) {
+            Refresh();
+        }
+
+        // Valid until the next call on this reader
+        const T* Get() {
+            if (source_->version_.load(std::memory_order_acquire) != version_) {
+                Refresh();
+            }
+            return cached_.Get();
+        }
+
+        const T& operator*() {
+            return *Get();
+        }
+
+        const T* operator->() {
+            return Get();
+        }
+
+        uint64_t Version() const {
+            return version_;
+        }
+
+    private:
+        void Refresh() {
+            SharedPtr<const T> stale;
+            {
+                std::lock_guard lock(source_->mutex_);
+                stale = std::exchange(cached_, source_->current_);
+                version_ = source_->version_.load(std::memory_order_relaxed);
+            }
+            // Might be the last holder of the old version: destroy it outside the lock
+        }
+
+        const Snapshot* source_;
+        SharedPtr<const T> cached_;
+        uint64_t version_ = 0;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit Snapshot(SharedPtr<const T> initial) : current_(std::move(initial)) {
+    }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Writers
+
+    void Publish(SharedPtr<const T> next) {
+        {
+            std::lock_guard lock(mutex_);
+            current_.Swap(next);
+            version_.fetch_add(1, std::memory_order_release);
+        }
+        // `next` holds the previous version now, release it outside the lock
+    }
+
+    template <typename... Args>
+    void Emplace(Args&&... args) {
+        Publish(MakeShared<T>(std::forward<Args>(args)...));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Readers
+
+    // One-off read, pays for a lock and a reference count
+    SharedPtr<const T> Load() const {
+        std::lock_guard lock(mutex_);
+        return current_;
+    }
+
+    Reader MakeReader() const {
+        return Reader(*this);
+    }
+
+    uint64_t Version() const {
+        return version_.load(std::memory_order_acquire);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    SharedPtr<const T> current_;
+    std::atomic<uint64_t> version_ = 0;
+};
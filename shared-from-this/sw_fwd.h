@@ -1,6 +1,20 @@
 #pragma once
 
+#include <common/array_bytes.h>
+#include <common/compressed_tuple.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
 
 // Instead of std::bad_weak_ptr
 class BadWeakPtr : public std::exception {};
@@ -11,77 +25,307 @@ class SharedPtr;
 template <typename T>
 class WeakPtr;
 
+template <typename K, typename V>
+class EphemeronMap;
+
+// Callbacks to run when the last strong reference destroys the object.
+class ExpiryHooks {
+public:
+    using Callback = std::function<void()>;
+    using Callbacks = std::vector<Callback>;
+
+    void Add(Callback callback) {
+        std::lock_guard lock(mutex_);
+        callbacks_.push_back(std::move(callback));
+    }
+
+    // Detach everything registered so far: the releasing thread runs the callbacks itself,
+    // after it has stopped touching the control block and without holding `mutex_`
+    Callbacks Take() {
+        std::lock_guard lock(mutex_);
+        return std::move(callbacks_);
+    }
+
+    static void Run(Callbacks& callbacks) {
+        for (auto& callback : callbacks) {
+            callback();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    Callbacks callbacks_;
+};
+
+// Collects tokens of expired objects, so registries can drop dead entries in one pass
+template <typename Token>
+class ExpiryQueue {
+public:
+    void Push(Token token) {
+        std::lock_guard lock(mutex_);
+        tokens_.push_back(std::move(token));
+    }
+
+    std::vector<Token> Drain() {
+        std::lock_guard lock(mutex_);
+        return std::move(tokens_);
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Token> tokens_;
+};
+
+// Counters are atomic, so copies of one `SharedPtr`/`WeakPtr` may live in different threads.
+// Strong owners hold one weak reference together: the block is freed by whoever drops the
+// last weak reference, and that can happen only after the object is destroyed.
+// An immortal block has both counters pinned at `kImmortal`: references to it are taken and
+// dropped without a write, so its cache line stays shared between cores
 class ControlBlockBase {
 public:
+    static constexpr size_t kImmortal = std::numeric_limits<size_t>::max();
+
     void AddReference() {
-        ref_counter_++;
+        if (Immortal()) {
+            return;
+        }
+        ref_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Promote a weak reference. Fails once the object is destroyed or being destroyed
+    bool TryAddReference() {
+        size_t count = ref_counter_.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (count == kImmortal) {
+                return true;
+            }
+            if (ref_counter_.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
     }
 
+    // The last strong reference destroys the object and may free the block itself,
+    // so the caller must not touch the block afterwards
     void RemoveReference() {
-        ref_counter_--;
+        if (Immortal() || ref_counter_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        auto expired = TakeExpiryCallbacks();
+        DeleteT();
+        DecWeakRef();
+        ExpiryHooks::Run(expired);
     }
 
     size_t GetRefCounter() const {
-        return ref_counter_;
+        return ref_counter_.load(std::memory_order_acquire);
+    }
+
+    // No other `SharedPtr` or `WeakPtr` refers to the object, and none can appear:
+    // both need an existing reference to be made from. `own_weak_refs` are held by the
+    // object itself, like the `weak_this_` of `EnableSharedFromThis`, and only the owner
+    // can reach them.
+    // Acquire loads pair with the releases of former owners, so their accesses to the
+    // object happen before anything the caller does next
+    bool IsUnique(size_t own_weak_refs = 0) const {
+        return ref_counter_.load(std::memory_order_acquire) == 1 &&
+               weak_ref_counter_.load(std::memory_order_acquire) == 1 + own_weak_refs;
+    }
+
+    bool Immortal() const {
+        return ref_counter_.load(std::memory_order_relaxed) == kImmortal;
+    }
+
+    // Only before the block is shared. The object is never destroyed and the block
+    // never freed
+    void MakeImmortal() {
+        ref_counter_.store(kImmortal, std::memory_order_relaxed);
+        weak_ref_counter_.store(kImmortal, std::memory_order_relaxed);
+    }
+
+    virtual ~ControlBlockBase() {
+        delete expiry_hooks_.load(std::memory_order_relaxed);
     }
-    virtual ~ControlBlockBase() = default;
 
     void AddWeakRef() {
-        weak_ref_counter_++;
+        if (Immortal()) {
+            return;
+        }
+        weak_ref_counter_.fetch_add(1, std::memory_order_relaxed);
     }
 
+    // May free the block
     void DecWeakRef() {
-        weak_ref_counter_--;
+        if (Immortal()) {
+            return;
+        }
+        if (weak_ref_counter_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            DestroyBlock();
+        }
     }
 
     virtual void DeleteT() = 0;
 
-    size_t GetWeakRefCounter() {
-        return weak_ref_counter_;
+    // Frees the block itself, through the allocator it was made with
+    virtual void DestroyBlock() = 0;
+
+    // Caller must hold a strong reference, so the object can't expire in the meantime.
+    // Hooks are allocated on first use: blocks nobody listens to pay one null check
+    void AddExpiryCallback(ExpiryHooks::Callback callback) {
+        ExpiryHooks* hooks = expiry_hooks_.load(std::memory_order_acquire);
+        if (!hooks) {
+            auto* fresh = new ExpiryHooks();
+            if (expiry_hooks_.compare_exchange_strong(hooks, fresh, std::memory_order_acq_rel)) {
+                hooks = fresh;
+            } else {
+                delete fresh;
+            }
+        }
+        hooks->Add(std::move(callback));
     }
 
 private:
-    size_t weak_ref_counter_ = 0;
-    size_t ref_counter_ = 0;
+    // Called on the last strong release, just before `DeleteT()`. The releasing thread runs
+    // the callbacks once it is done with the block: they may drop the last `WeakPtr`
+    ExpiryHooks::Callbacks TakeExpiryCallbacks() {
+        ExpiryHooks* hooks = expiry_hooks_.load(std::memory_order_acquire);
+        if (!hooks) {
+            return {};
+        }
+        return hooks->Take();
+    }
+
+    std::atomic<size_t> weak_ref_counter_ = 1;
+    std::atomic<size_t> ref_counter_ = 1;
+    std::atomic<ExpiryHooks*> expiry_hooks_ = nullptr;
 };
 
-template <typename T>
+template <typename Block, typename Alloc, typename... Args>
+Block* AllocateControlBlock(const Alloc& alloc, Args&&... args) {
+    using Traits = typename std::allocator_traits<Alloc>::template rebind_traits<Block>;
+    typename Traits::allocator_type block_alloc(alloc);
+    Block* block = Traits::allocate(block_alloc, 1);
+    try {
+        Traits::construct(block_alloc, block, std::forward<Args>(args)...);
+    } catch (...) {
+        Traits::deallocate(block_alloc, block, 1);
+        throw;
+    }
+    return block;
+}
+
+// `alloc` may live inside the block, so it is copied out before the block is destroyed
+template <typename Block, typename Alloc>
+void DeallocateControlBlock(Block* block, const Alloc& alloc) {
+    using Traits = typename std::allocator_traits<Alloc>::template rebind_traits<Block>;
+    typename Traits::allocator_type block_alloc(alloc);
+    Traits::destroy(block_alloc, block);
+    Traits::deallocate(block_alloc, block, 1);
+}
+
+// Owns a separately allocated object. Stateless deleters and allocators take no space
+template <typename T, typename Deleter = std::default_delete<T>,
+          typename Alloc = std::allocator<std::remove_cv_t<T>>>
 class ControlBlockPointer : public ControlBlockBase {
 public:
-    ControlBlockPointer() = default;
-
-    ControlBlockPointer(T* ptr) : ptr_(ptr) {
-        if (ptr_) {
-            ControlBlockBase::AddReference();
-        }
+    ControlBlockPointer(T* ptr, Deleter deleter = Deleter(), const Alloc& alloc = Alloc())
+        : ptr_deleter_alloc_(ptr, std::move(deleter), alloc) {
     }
 
     void DeleteT() override {
-        delete ptr_;
+        ptr_deleter_alloc_.template Get<1>()(ptr_deleter_alloc_.template Get<0>());
     }
 
-    ~ControlBlockPointer() {
-        //        std::cout << "Delete in blockptr" << '\n';
+    void DestroyBlock() override {
+        DeallocateControlBlock(this, ptr_deleter_alloc_.template Get<2>());
     }
 
 private:
-    T* ptr_;
+    CompressedTuple<T*, Deleter, Alloc> ptr_deleter_alloc_;
 };
 
-template <typename T>
+// Object and block in one allocation
+template <typename T, typename Alloc = std::allocator<std::remove_cv_t<T>>>
 class ControlBlockHolder : public ControlBlockBase {
     template <typename Y>
     friend class SharedPtr;
 
-public:
-    //    ControlBlockHolder() {
-    //        AddReference();
-    //    };
+    using Storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
 
+public:
     template <class... Args>
-    ControlBlockHolder(Args&&... args) {
-        new (&storage_) T(std::forward<Args>(args)...);
-        AddReference();
+    ControlBlockHolder(std::allocator_arg_t, const Alloc& alloc, Args&&... args)
+        : alloc_storage_(alloc) {
+        new (&alloc_storage_.template Get<1>()) T(std::forward<Args>(args)...);
+    }
+
+    T* GetPointer() {
+        return reinterpret_cast<T*>(&alloc_storage_.template Get<1>());
+    }
+
+    void DeleteT() override {
+        GetPointer()->~T();
+    }
+
+    void DestroyBlock() override {
+        DeallocateControlBlock(this, alloc_storage_.template Get<0>());
+    }
+
+private:
+    CompressedTuple<Alloc, Storage> alloc_storage_;
+};
+
+// Block followed by raw bytes, in one allocation
+class ControlBlockBytes : public ControlBlockBase {
+public:
+    static ControlBlockBytes* Create(size_t size) {
+        return new (::operator new(ArrayBytes(size, 1, sizeof(ControlBlockBytes))))
+            ControlBlockBytes();
+    }
+
+    std::byte* Data() {
+        return reinterpret_cast<std::byte*>(this + 1);
+    }
+
+    void DeleteT() override {
+    }
+
+    void DestroyBlock() override {
+        this->~ControlBlockBytes();
+        ::operator delete(this);
+    }
+
+private:
+    ControlBlockBytes() = default;
+};
+
+// Block, object and `size` trailing elements in one allocation. The elements are built
+// first, so `T` gets them in its constructor; they live and die together with `T`.
+// `Create` throws `std::bad_array_new_length` if the block size does not fit in `size_t`
+template <typename T, typename Elem>
+class ControlBlockTrailing : public ControlBlockBase {
+public:
+    template <typename... Args>
+    static ControlBlockTrailing* Create(size_t size, Args&&... args) {
+        void* memory = ::operator new(ArrayBytes(size, sizeof(Elem), ElementsOffset()),
+                                      std::align_val_t(Alignment()));
+        auto* elements =
+            reinterpret_cast<Elem*>(static_cast<std::byte*>(memory) + ElementsOffset());
+        try {
+            std::uninitialized_value_construct_n(elements, size);
+        } catch (...) {
+            ::operator delete(memory, std::align_val_t(Alignment()));
+            throw;
+        }
+        try {
+            return new (memory) ControlBlockTrailing(size, std::forward<Args>(args)...);
+        } catch (...) {
+            std::destroy_n(elements, size);
+            ::operator delete(memory, std::align_val_t(Alignment()));
+            throw;
+        }
     }
 
     T* GetPointer() {
@@ -90,12 +334,32 @@ public:
 
     void DeleteT() override {
         GetPointer()->~T();
+        std::destroy_n(Elements(), size_);
     }
 
-    ~ControlBlockHolder() {
-        //        GetPointer()->~T();
+    void DestroyBlock() override {
+        this->~ControlBlockTrailing();
+        ::operator delete(this, std::align_val_t(Alignment()));
     }
 
 private:
+    template <typename... Args>
+    explicit ControlBlockTrailing(size_t size, Args&&... args) : size_(size) {
+        new (&storage_) T(std::span<Elem>(Elements(), size), std::forward<Args>(args)...);
+    }
+
+    static constexpr size_t Alignment() {
+        return std::max(alignof(ControlBlockTrailing), alignof(Elem));
+    }
+
+    static constexpr size_t ElementsOffset() {
+        return (sizeof(ControlBlockTrailing) + alignof(Elem) - 1) / alignof(Elem) * alignof(Elem);
+    }
+
+    Elem* Elements() {
+        return reinterpret_cast<Elem*>(reinterpret_cast<std::byte*>(this) + ElementsOffset());
+    }
+
+    size_t size_;
     std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
 };
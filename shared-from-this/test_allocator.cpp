@@ -0,0 +1,131 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    explicit CountingAllocator(int* live) : live(live) {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : live(other.live) {
+    }
+
+    T* allocate(size_t n) {
+        ++*live;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        --*live;
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& other) const {
+        return live == other.live;
+    }
+
+    int* live;
+};
+
+struct EmptyDeleter {
+    void operator()(std::string* ptr) const {
+        delete ptr;
+    }
+};
+
+static_assert(sizeof(ControlBlockPointer<int>) == sizeof(ControlBlockBase) + sizeof(int*));
+static_assert(sizeof(ControlBlockPointer<std::string, EmptyDeleter>) ==
+              sizeof(ControlBlockPointer<std::string>));
+
+TEST_CASE("Custom deleter") {
+    SECTION("Stateful") {
+        int deleted = 0;
+        {
+            SharedPtr<int> a(new int(42), [&deleted](int* ptr) {
+                ++deleted;
+                delete ptr;
+            });
+            SharedPtr<int> b = a;
+            a.Reset();
+            REQUIRE(deleted == 0);
+            REQUIRE(*b == 42);
+        }
+        REQUIRE(deleted == 1);
+    }
+
+    SECTION("Reset") {
+        int deleted = 0;
+        auto deleter = [&deleted](int* ptr) {
+            ++deleted;
+            delete ptr;
+        };
+        SharedPtr<int> a;
+        a.Reset(new int(1), deleter);
+        a.Reset(new int(2), deleter);
+        REQUIRE(deleted == 1);
+        a.Reset();
+        REQUIRE(deleted == 2);
+    }
+
+    SECTION("Weak outlives the object") {
+        int deleted = 0;
+        WeakPtr<std::string> weak;
+        {
+            SharedPtr<std::string> shared(new std::string("aba"), [&deleted](std::string* ptr) {
+                ++deleted;
+                delete ptr;
+            });
+            weak = shared;
+        }
+        REQUIRE(deleted == 1);
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Non-owning") {
+        static int value = 7;
+        SharedPtr<int> a(&value, [](int*) {});
+        REQUIRE(*a == 7);
+    }
+}
+
+TEST_CASE("Custom allocator") {
+    int live = 0;
+
+    SECTION("AllocateShared") {
+        {
+            auto a = AllocateShared<std::string>(CountingAllocator<std::string>(&live), "abacaba");
+            REQUIRE(live == 1);
+            REQUIRE(*a == "abacaba");
+            WeakPtr<std::string> weak = a;
+            a.Reset();
+            REQUIRE(weak.Expired());
+            REQUIRE(live == 1);
+        }
+        REQUIRE(live == 0);
+    }
+
+    SECTION("Pointer, deleter and allocator") {
+        int deleted = 0;
+        {
+            SharedPtr<int> a(
+                new int(3),
+                [&deleted](int* ptr) {
+                    ++deleted;
+                    delete ptr;
+                },
+                CountingAllocator<int>(&live));
+            REQUIRE(live == 1);
+        }
+        REQUIRE(deleted == 1);
+        REQUIRE(live == 0);
+    }
+}
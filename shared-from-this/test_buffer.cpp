@@ -0,0 +1,140 @@
+#include "buffer.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+SharedBuffer FromText(std::string_view text) {
+    return SharedBuffer::Copy(std::as_bytes(std::span(text.data(), text.size())));
+}
+
+std::string ToText(const BufferChain& chain) {
+    auto bytes = chain.Flatten();
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+std::string_view ToText(const SharedBuffer& buffer) {
+    return {reinterpret_cast<const char*>(buffer.Data()), buffer.Size()};
+}
+
+}  // namespace
+
+TEST_CASE("SharedBuffer") {
+    SECTION("One allocation") {
+        EXPECT_ONE_ALLOCATION(auto buffer = SharedBuffer::Allocate(1000));
+    }
+
+    SECTION("Slices share the block") {
+        SharedBuffer text = FromText("abracadabra");
+        SharedBuffer cad = text.Slice(4, 3);
+        REQUIRE(ToText(cad) == "cad");
+        REQUIRE(cad.Data() == text.Data() + 4);
+        REQUIRE(text.UseCount() == 2);
+        REQUIRE_THROWS_AS(text.Slice(10, 2), std::out_of_range);
+
+        SharedBuffer front = text.SplitFront(4);
+        REQUIRE(ToText(front) == "abra");
+        REQUIRE(ToText(text) == "cadabra");
+        REQUIRE(text.UseCount() == 3);
+    }
+}
+
+TEST_CASE("BufferChain") {
+    BufferChain chain;
+    chain.Append(FromText("hello, "));
+    chain.Append(FromText("buffer "));
+    chain.Append(SharedBuffer());
+    chain.Append(FromText("chain"));
+    REQUIRE(chain.Size() == 19);
+    REQUIRE(chain.Buffers().size() == 3);
+
+    SECTION("Slice") {
+        REQUIRE(ToText(chain.Slice(5, 9)) == ", buffer ");
+        REQUIRE(chain.Slice(5, 9).Buffers().size() == 2);
+        REQUIRE(ToText(chain.Slice(19, 0)).empty());
+        REQUIRE_THROWS_AS(chain.Slice(10, 10), std::out_of_range);
+    }
+
+    SECTION("SplitFront") {
+        BufferChain front = chain.SplitFront(10);
+        REQUIRE(ToText(front) == "hello, buf");
+        REQUIRE(ToText(chain) == "fer chain");
+        REQUIRE(chain.Buffers().front().UseCount() == 2);
+        front.Append(std::move(chain));
+        REQUIRE(ToText(front) == "hello, buffer chain");
+    }
+
+    SECTION("writev and readv") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        REQUIRE(chain.WriteTo(fds[1]) == 19);
+        REQUIRE(chain.Empty());
+        close(fds[1]);
+
+        BufferChain received;
+        while (received.ReadFrom(fds[0], 100, 4) > 0) {
+        }
+        close(fds[0]);
+        REQUIRE(ToText(received) == "hello, buffer chain");
+        REQUIRE(received.Buffers().size() == 5);
+    }
+
+    SECTION("DropFront") {
+        chain.DropFront(10);
+        REQUIRE(ToText(chain) == "fer chain");
+        REQUIRE(chain.Buffers().size() == 2);
+        REQUIRE_THROWS_AS(chain.DropFront(10), std::out_of_range);
+        chain.DropFront(9);
+        REQUIRE(chain.Empty());
+        REQUIRE(chain.Buffers().empty());
+    }
+
+    SECTION("Short reads") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        BufferChain received;
+        REQUIRE_THROWS_AS(received.ReadFrom(fds[0], 100, 0), std::invalid_argument);
+
+        REQUIRE(write(fds[1], "abc", 3) == 3);
+        REQUIRE(received.ReadFrom(fds[0], 1000, 256) == 3);
+        REQUIRE(ToText(received) == "abc");
+        REQUIRE(received.Buffers().size() == 1);
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+TEST_CASE("Long BufferChain") {
+    // More buffers than one `writev` takes
+    constexpr size_t kBuffers = 5000;
+    SharedBuffer letters = FromText("abcdefghijklmnopqrstuvwxyz");
+    BufferChain chain;
+    std::string expected;
+    for (size_t i = 0; i < kBuffers; ++i) {
+        chain.Append(letters.Slice(i % 26, 1));
+        expected += static_cast<char>('a' + i % 26);
+    }
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(chain.WriteTo(fds[1]) == kBuffers);
+    REQUIRE(chain.Empty());
+    REQUIRE(letters.UseCount() == 1);
+    close(fds[1]);
+
+    BufferChain received;
+    while (received.ReadFrom(fds[0], kBuffers, 1024) > 0) {
+    }
+    close(fds[0]);
+    REQUIRE(ToText(received) == expected);
+}
@@ -0,0 +1,125 @@
+#include "cow.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("CowPtr basic") {
+    auto a = MakeCow<std::string>("aba");
+    CowPtr<std::string> b = a;
+    REQUIRE(a.Get() == b.Get());
+    REQUIRE(a.UseCount() == 2);
+
+    b.Mutable() += "caba";
+    REQUIRE(*a == "aba");
+    REQUIRE(*b == "abacaba");
+    REQUIRE(a.UseCount() == 1);
+    REQUIRE(b.UseCount() == 1);
+
+    const std::string* before = b.Get();
+    b.Mutable() += "!";
+    REQUIRE(b.Get() == before);
+    REQUIRE(*b == "abacaba!");
+}
+
+TEST_CASE("CowPtr shared handles") {
+    CowPtr<std::string> a(std::string("doc"));
+    SharedPtr<const std::string> reader = a.Share();
+    a.Mutable() = "edited";
+    REQUIRE(*reader == "doc");
+    REQUIRE(*a == "edited");
+
+    reader.Reset();
+    const std::string* before = a.Get();
+    a.Mutable() = "again";
+    REQUIRE(a.Get() == before);
+}
+
+TEST_CASE("SharedPtr uniqueness") {
+    auto a = MakeShared<int>(1);
+    REQUIRE(a.IsUnique());
+    {
+        WeakPtr<int> weak(a);
+        REQUIRE(a.UseCount() == 1);
+        REQUIRE(!a.IsUnique());
+    }
+    REQUIRE(a.IsUnique());
+    SharedPtr<int> b = a;
+    REQUIRE(!a.IsUnique());
+    REQUIRE(!SharedPtr<int>().IsUnique());
+}
+
+namespace {
+
+struct Node : EnableSharedFromThis<Node> {
+    Node() = default;
+
+    // The copy has no owner yet
+    Node(const Node& other) : value(other.value) {
+    }
+
+    int value = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Uniqueness with EnableSharedFromThis") {
+    SharedPtr<const Node> as_const = MakeShared<Node>();
+    REQUIRE(as_const.IsUnique());
+
+    auto node = MakeShared<Node>();
+    REQUIRE(node.IsUnique());
+    as_const = node;
+    REQUIRE(!node.IsUnique());
+    as_const.Reset();
+    REQUIRE(node.IsUnique());
+    {
+        WeakPtr<Node> weak = node->WeakFromThis();
+        REQUIRE(!node.IsUnique());
+    }
+    REQUIRE(node.IsUnique());
+
+    // Through a pointer to a member the object's `weak_this_` can't be seen, so it counts
+    SharedPtr<int> value(node, &node->value);
+    REQUIRE(!node.IsUnique());
+    node.Reset();
+    REQUIRE(!value.IsUnique());
+
+    auto cow = MakeCow<Node>();
+    const Node* before = cow.Get();
+    cow.Mutable().value = 1;
+    REQUIRE(cow.Get() == before);
+    CowPtr<Node> copy = cow;
+    copy.Mutable().value = 2;
+    REQUIRE(copy.Get() != before);
+    REQUIRE(cow->value == 1);
+    REQUIRE(copy.Get()->SharedFromThis().Get() == copy.Get());
+}
+
+TEST_CASE("CowPtr across threads") {
+    auto doc = MakeCow<std::vector<int>>(1000, 1);
+    std::atomic<int> corrupted = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([doc, i, &corrupted]() mutable {
+            for (int j = 0; j < 1000; ++j) {
+                CowPtr<std::vector<int>> copy = doc;
+                copy.Mutable()[j] = i + 2;
+                if ((*doc)[j] != 1) {
+                    ++corrupted;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(corrupted == 0);
+    REQUIRE(doc.UseCount() == 1);
+}
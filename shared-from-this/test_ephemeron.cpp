@@ -0,0 +1,144 @@
+#include "ephemeron.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Pair {
+    std::string first;
+    std::string second;
+};
+
+TEST_CASE("Ephemeron basic") {
+    EphemeronMap<std::string, int> map;
+    auto a = MakeShared<std::string>("aba");
+    auto b = MakeShared<std::string>("aba");
+
+    map.Insert(a, 1);
+    map.Insert(b, 2);
+    REQUIRE(map.Size() == 2);
+    REQUIRE(*map.Find(a) == 1);
+    REQUIRE(*map.Find(b) == 2);
+
+    map.Insert(a, 3);
+    REQUIRE(map.Size() == 2);
+    REQUIRE(*map.Find(a) == 3);
+
+    REQUIRE(map.Erase(b));
+    REQUIRE(!map.Erase(b));
+    REQUIRE(map.Find(b) == nullptr);
+    REQUIRE(map.Size() == 1);
+}
+
+TEST_CASE("Ephemeron does not keep keys alive") {
+    EphemeronMap<std::string, std::string> map;
+    auto a = MakeShared<std::string>("key");
+    WeakPtr<std::string> weak(a);
+    map.Insert(a, "value");
+    REQUIRE(a.UseCount() == 1);
+
+    a.Reset();
+    REQUIRE(weak.Expired());
+    REQUIRE(map.Size() == 0);
+}
+
+TEST_CASE("Ephemeron keys by owner") {
+    EphemeronMap<std::string, int> map;
+    auto pair = MakeShared<Pair>();
+    SharedPtr<std::string> first(pair, &pair->first);
+    SharedPtr<std::string> second(pair, &pair->second);
+
+    map.Insert(first, 1);
+    REQUIRE(map.Find(second) != nullptr);
+    REQUIRE(*map.Find(second) == 1);
+
+    first.Reset();
+    REQUIRE(map.Size() == 1);
+    pair.Reset();
+    REQUIRE(map.Size() == 1);
+    second.Reset();
+    REQUIRE(map.Size() == 0);
+}
+
+TEST_CASE("Ephemeron outlived by keys") {
+    auto a = MakeShared<std::string>("key");
+    {
+        EphemeronMap<std::string, int> map;
+        map.Insert(a, 1);
+    }
+    a.Reset();
+}
+
+TEST_CASE("Ephemeron erase and insert again") {
+    EphemeronMap<std::string, int> map;
+    auto a = MakeShared<std::string>("key");
+    for (int i = 0; i < 1000; ++i) {
+        map.Insert(a, i);
+        REQUIRE(map.Erase(a));
+    }
+    REQUIRE(map.Size() == 0);
+    REQUIRE(map.Find(a) == nullptr);
+
+    map.Insert(a, 1);
+    REQUIRE(*map.Find(a) == 1);
+    a.Reset();
+    REQUIRE(map.Size() == 0);
+}
+
+TEST_CASE("Ephemeron erased key expires") {
+    EphemeronMap<std::string, int> map;
+    for (int i = 0; i < 100; ++i) {
+        auto a = MakeShared<std::string>("old");
+        map.Insert(a, 1);
+        map.Erase(a);
+        a.Reset();
+
+        // May get the old block's address
+        auto b = MakeShared<std::string>("new");
+        map.Insert(b, 2);
+        REQUIRE(*map.Find(b) == 2);
+        REQUIRE(map.Size() == 1);
+        b.Reset();
+        REQUIRE(map.Size() == 0);
+    }
+}
+
+namespace {
+
+// Calls back into the map when destroyed, which deadlocks if that happens under its lock
+struct Reentrant {
+    Reentrant(EphemeronMap<std::string, Reentrant>* map = nullptr, size_t* seen = nullptr)
+        : map(map), seen(seen) {
+    }
+
+    Reentrant(Reentrant&& other) noexcept
+        : map(std::exchange(other.map, nullptr)), seen(other.seen) {
+    }
+
+    EphemeronMap<std::string, Reentrant>* map;
+    size_t* seen;
+
+    ~Reentrant() {
+        if (map) {
+            *seen = map->Size();
+        }
+    }
+};
+
+}  // namespace
+
+TEST_CASE("Ephemeron destroys values outside the lock") {
+    EphemeronMap<std::string, Reentrant> map;
+    auto a = MakeShared<std::string>("key");
+    size_t seen = 0;
+    map.Insert(a, Reentrant(&map, &seen));
+    map.Insert(a, Reentrant(&map, &seen));
+    REQUIRE(seen == 1);  // The old value saw the map, and the map wasn't locked
+
+    seen = 2;
+    map.Erase(a);
+    REQUIRE(seen == 0);
+}
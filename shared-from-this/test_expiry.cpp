@@ -0,0 +1,79 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Expiry callbacks") {
+    SECTION("Run on last strong release") {
+        int fired = 0;
+        SharedPtr<std::string> a(new std::string("aba"));
+        SharedPtr<std::string> b = a;
+        WeakPtr<std::string> weak(a);
+        weak.OnExpire([&] {
+            ++fired;
+            REQUIRE(weak.Expired());
+        });
+
+        a.Reset();
+        REQUIRE(fired == 0);
+        b.Reset();
+        REQUIRE(fired == 1);
+        weak.Reset();
+        REQUIRE(fired == 1);
+    }
+
+    SECTION("Without weak references") {
+        int fired = 0;
+        {
+            auto a = MakeShared<std::string>("caba");
+            a.OnExpire([&] { ++fired; });
+            a.OnExpire([&] { ++fired; });
+        }
+        REQUIRE(fired == 2);
+    }
+
+    SECTION("Already expired") {
+        int fired = 0;
+        WeakPtr<int> weak;
+        weak.OnExpire([&] { ++fired; });
+        REQUIRE(fired == 1);
+
+        {
+            SharedPtr<int> a(new int(1));
+            weak = a;
+        }
+        weak.OnExpire([&] { ++fired; });
+        REQUIRE(fired == 2);
+    }
+
+    SECTION("Callback drops the last weak reference") {
+        std::vector<WeakPtr<int>> registry;
+        SharedPtr<int> a(new int(42));
+        registry.emplace_back(a);
+        registry.back().OnExpire([&] { registry.clear(); });
+        a.Reset();
+        REQUIRE(registry.empty());
+    }
+}
+
+TEST_CASE("Expiry queue") {
+    ExpiryQueue<int> queue;
+    std::vector<SharedPtr<int>> objects;
+    for (int i = 0; i < 5; ++i) {
+        objects.push_back(MakeShared<int>(i));
+        WeakPtr<int>(objects.back()).OnExpire(queue, i);
+    }
+    REQUIRE(queue.Drain().empty());
+
+    objects[1].Reset();
+    objects[3].Reset();
+    REQUIRE(queue.Drain() == std::vector<int>{1, 3});
+
+    objects.clear();
+    REQUIRE(queue.Drain().size() == 3);
+}
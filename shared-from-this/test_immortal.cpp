@@ -0,0 +1,93 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Counted {
+    static inline int destroyed = 0;
+
+    explicit Counted(std::string name) : name(std::move(name)) {
+    }
+
+    ~Counted() {
+        ++destroyed;
+    }
+
+    std::string name;
+};
+
+const SharedPtr<Counted>& EmptyName() {
+    static const SharedPtr<Counted> kEmpty = MakeImmortal<Counted>("");
+    return kEmpty;
+}
+
+}  // namespace
+
+TEST_CASE("Immortal singleton") {
+    const auto& singleton = EmptyName();
+    REQUIRE(singleton->name.empty());
+
+    SECTION("Copies don't count") {
+        size_t count = singleton.UseCount();
+        {
+            auto a = singleton;
+            auto b = a;
+            SharedPtr<Counted> c;
+            c = std::move(b);
+            REQUIRE(singleton.UseCount() == count);
+        }
+        REQUIRE(singleton.UseCount() == count);
+        REQUIRE(Counted::destroyed == 0);
+    }
+
+    SECTION("No allocations") {
+        EXPECT_ZERO_ALLOCATIONS(auto a = singleton; auto b = a; a.Reset(););
+    }
+
+    SECTION("Weak references never expire") {
+        WeakPtr<Counted> weak(singleton);
+        REQUIRE(!weak.Expired());
+        REQUIRE(weak.Lock().Get() == singleton.Get());
+        weak.Reset();
+        REQUIRE(!WeakPtr<Counted>(singleton).Expired());
+    }
+
+    SECTION("Never unique") {
+        REQUIRE(!singleton.IsUnique());
+    }
+
+    SECTION("Shared between threads") {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([] {
+                for (int j = 0; j < 10000; ++j) {
+                    auto copy = EmptyName();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(Counted::destroyed == 0);
+    }
+}
+
+TEST_CASE("Mortal objects are unaffected") {
+    Counted::destroyed = 0;
+    {
+        auto a = MakeShared<Counted>("x");
+        auto b = a;
+        REQUIRE(a.UseCount() == 2);
+    }
+    REQUIRE(Counted::destroyed == 1);
+}
@@ -0,0 +1,89 @@
+#include "mapped_file.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+class TempFile {
+public:
+    explicit TempFile(std::string_view contents)
+        : path_(std::filesystem::temp_directory_path() /
+                ("mapped_file_test_" + std::to_string(reinterpret_cast<uintptr_t>(this)))) {
+        std::ofstream(path_, std::ios::binary) << contents;
+    }
+
+    ~TempFile() {
+        std::filesystem::remove(path_);
+    }
+
+    std::string Path() const {
+        return path_.string();
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+std::string_view AsText(std::span<const std::byte> bytes) {
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+}  // namespace
+
+TEST_CASE("Mapped file") {
+    SECTION("Contents") {
+        TempFile file("hello, mapped world");
+        auto mapped = MappedFile::Open(file.Path());
+        REQUIRE(mapped.Size() == 19);
+        REQUIRE(AsText(mapped.Bytes()) == "hello, mapped world");
+        mapped.Advise(MappingAdvice::kSequential);
+        mapped.Advise(MappingAdvice::kWillNeed);
+
+        MappedFile moved = std::move(mapped);
+        REQUIRE(moved.Size() == 19);
+        REQUIRE(mapped.Size() == 0);
+        REQUIRE(mapped.Bytes().empty());
+    }
+
+    SECTION("Zero-copy slices") {
+        TempFile file("hello, mapped world");
+        MappedSlice hello;
+        MappedSlice world;
+        {
+            auto mapped = MappedFile::Open(file.Path());
+            MappedSlice whole = std::move(mapped).Share();
+            REQUIRE(mapped.Data() == nullptr);
+            REQUIRE(mapped.Size() == 0);
+            REQUIRE(mapped.Bytes().empty());
+            hello = whole.Sub(0, 5);
+            world = whole.Sub(14, 5);
+            REQUIRE(hello.Data() == whole.Data());
+            REQUIRE(whole.UseCount() == 3);
+        }
+        REQUIRE(hello.UseCount() == 2);
+        REQUIRE(AsText(hello.Bytes()) == "hello");
+        REQUIRE(AsText(world.Sub(1, 3).Bytes()) == "orl");
+        world.Advise(MappingAdvice::kRandom);
+        REQUIRE_THROWS_AS(world.Sub(3, 3), std::out_of_range);
+    }
+
+    SECTION("Empty file") {
+        TempFile file("");
+        auto mapped = MappedFile::Open(file.Path());
+        REQUIRE(mapped.Size() == 0);
+        REQUIRE(mapped.Bytes().empty());
+        REQUIRE(std::move(mapped).Share().Size() == 0);
+    }
+
+    SECTION("Missing file") {
+        REQUIRE_THROWS_AS(MappedFile::Open("/nonexistent/mapped/file"), std::system_error);
+    }
+}
@@ -0,0 +1,102 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Pair {
+    int first = 0;
+    int second = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Owner comparison") {
+    auto pair = MakeShared<Pair>();
+    SharedPtr<int> first(pair, &pair->first);
+    SharedPtr<int> second(pair, &pair->second);
+    auto other = MakeShared<Pair>();
+    WeakPtr<int> weak(first);
+
+    REQUIRE(!(first == second));
+    REQUIRE(first.OwnerEqual(second));
+    REQUIRE(first.OwnerEqual(pair));
+    REQUIRE(weak.OwnerEqual(second));
+    REQUIRE(!weak.OwnerEqual(other));
+    REQUIRE(first.OwnerHash() == second.OwnerHash());
+    REQUIRE(weak.OwnerHash() == pair.OwnerHash());
+
+    REQUIRE(!first.OwnerBefore(second));
+    REQUIRE(!second.OwnerBefore(first));
+    REQUIRE(pair.OwnerBefore(other) != other.OwnerBefore(pair));
+    REQUIRE(weak.OwnerBefore(other) == pair.OwnerBefore(other));
+}
+
+TEST_CASE("WeakPtr as a key") {
+    std::set<WeakPtr<std::string>, OwnerBefore> ordered;
+    std::unordered_set<WeakPtr<std::string>, OwnerHash, OwnerEqual> hashed;
+
+    auto a = MakeShared<std::string>("a");
+    auto b = MakeShared<std::string>("b");
+    ordered.emplace(a);
+    ordered.emplace(b);
+    ordered.emplace(a);
+    hashed.emplace(a);
+    hashed.emplace(b);
+    hashed.emplace(a);
+    REQUIRE(ordered.size() == 2);
+    REQUIRE(hashed.size() == 2);
+
+    WeakPtr<std::string> weak(a);
+    size_t hash = std::hash<WeakPtr<std::string>>()(weak);
+    a.Reset();
+    REQUIRE(weak.Expired());
+    REQUIRE(std::hash<WeakPtr<std::string>>()(weak) == hash);
+    REQUIRE(ordered.count(weak) == 1);
+    REQUIRE(hashed.count(weak) == 1);
+}
+
+TEST_CASE("SharedPtr hash") {
+    std::unordered_map<SharedPtr<int>, int> map;
+    std::vector<SharedPtr<int>> ptrs;
+    for (int i = 0; i < 100; ++i) {
+        ptrs.push_back(MakeShared<int>(i));
+        map[ptrs.back()] = i;
+    }
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(map.at(ptrs[i]) == i);
+    }
+
+    std::unordered_set<size_t> hashes;
+    for (const auto& ptr : ptrs) {
+        hashes.insert(std::hash<SharedPtr<int>>()(ptr) % 64);
+    }
+    REQUIRE(hashes.size() > 32);
+}
+
+TEST_CASE("WeakPtr default hash") {
+    auto first = MakeShared<Pair>(Pair{1, 2});
+    auto second = MakeShared<Pair>(Pair{3, 4});
+    SharedPtr<int> member(first, &first->second);
+
+    std::unordered_set<WeakPtr<int>> set;
+    set.emplace(SharedPtr<int>(first, &first->first));
+    set.emplace(member);
+    set.emplace(SharedPtr<int>(second, &second->first));
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.count(WeakPtr<int>(member)) == 1);
+    REQUIRE(WeakPtr<int>(member) == WeakPtr<Pair>(first));
+
+    second.Reset();
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.count(WeakPtr<int>()) == 0);
+}
@@ -0,0 +1,68 @@
+#include "region.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Shared region") {
+    SECTION("Handles share the region's count") {
+        SharedRegion region;
+        auto a = region.Make<std::string>("aba");
+        auto b = region.Make<int>(42);
+        REQUIRE(*a == "aba");
+        REQUIRE(*b == 42);
+        REQUIRE(a.UseCount() == 3);
+        REQUIRE(region.UseCount() == 3);
+        REQUIRE(a.OwnerEqual(b));
+    }
+
+    SECTION("Region dies with the last handle") {
+        SharedPtr<MyInt> last;
+        {
+            SharedRegion region;
+            for (int i = 0; i < 100; ++i) {
+                last = region.Make<MyInt>(i);
+            }
+            REQUIRE(MyInt::AliveCount() == 100);
+        }
+        REQUIRE(MyInt::AliveCount() == 100);
+        REQUIRE(*last == 99);
+        last.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("No allocation per object") {
+        SharedRegion region(1 << 16);
+        region.Make<int>(0);
+        std::vector<SharedPtr<int>> handles;
+        handles.reserve(1000);
+        EXPECT_ZERO_ALLOCATIONS(for (int i = 0; i < 1000; ++i) {
+            handles.push_back(region.Make<int>(i));
+        });
+        REQUIRE(handles[999].UseCount() == 1001);
+    }
+
+    SECTION("Throwing constructor") {
+        struct Throws {
+            Throws() {
+                throw 1;
+            }
+            ~Throws() {
+                FAIL("Destroyed an object that was never built");
+            }
+        };
+        SharedRegion region;
+        auto a = region.Make<MyInt>(1);
+        REQUIRE_THROWS(region.Make<Throws>());
+        a.Reset();
+    }
+
+    REQUIRE(MyInt::AliveCount() == 0);
+}
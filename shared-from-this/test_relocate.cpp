@@ -0,0 +1,109 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <common/relocating_vector.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static_assert(std::is_nothrow_move_constructible_v<SharedPtr<int>>);
+static_assert(std::is_nothrow_move_assignable_v<SharedPtr<int>>);
+static_assert(std::is_nothrow_move_constructible_v<WeakPtr<int>>);
+static_assert(std::is_nothrow_move_assignable_v<WeakPtr<int>>);
+static_assert(kIsTriviallyRelocatable<SharedPtr<int>>);
+static_assert(kIsTriviallyRelocatable<WeakPtr<int>>);
+static_assert(!kIsTriviallyRelocatable<std::string>);
+
+TEST_CASE("Relocating SharedPtr") {
+    auto shared = MakeShared<std::string>("aba");
+    WeakPtr<std::string> weak(shared);
+    {
+        RelocatingVector<SharedPtr<std::string>> ptrs;
+        RelocatingVector<WeakPtr<std::string>> weaks;
+        for (int i = 0; i < 100; ++i) {
+            ptrs.PushBack(shared);
+            weaks.EmplaceBack(shared);
+        }
+        REQUIRE(shared.UseCount() == 101);
+        ptrs.EmplaceBack(ptrs[0]);
+        REQUIRE(shared.UseCount() == 102);
+        for (auto& ptr : weaks) {
+            REQUIRE(*ptr.Lock() == "aba");
+        }
+    }
+    REQUIRE(shared.UseCount() == 1);
+    shared.Reset();
+    REQUIRE(weak.Expired());
+}
+
+TEST_CASE("Relocating non-relocatable") {
+    RelocatingVector<std::string> strings;
+    strings.Reserve(2);
+    REQUIRE(strings.Capacity() == 2);
+    for (int i = 0; i < 50; ++i) {
+        strings.EmplaceBack(100, 'a' + i % 26);
+    }
+    strings.EmplaceBack(strings[0]);
+    REQUIRE(strings.Size() == 51);
+    REQUIRE(strings[50] == std::string(100, 'a'));
+    REQUIRE(strings[25] == std::string(100, 'z'));
+    strings.Clear();
+    REQUIRE(strings.Empty());
+
+    REQUIRE(RelocatingVector<std::string>::MaxSize() == SIZE_MAX / sizeof(std::string));
+    REQUIRE_THROWS_AS(strings.Reserve(strings.MaxSize() + 1), std::length_error);
+    REQUIRE_THROWS_AS(strings.Reserve(SIZE_MAX), std::length_error);
+    REQUIRE(strings.Capacity() >= 51);
+}
+
+namespace {
+
+// Its move may throw, so growing copies it, and the copy throws once `copies_left` runs out
+struct FragileCopy {
+    static inline int alive = 0;
+    static inline int copies_left = 0;
+
+    explicit FragileCopy(int value) : value(value) {
+        ++alive;
+    }
+
+    FragileCopy(const FragileCopy& other) : value(other.value) {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+        ++alive;
+    }
+
+    FragileCopy(FragileCopy&& other) : FragileCopy(static_cast<const FragileCopy&>(other)) {
+    }
+
+    ~FragileCopy() {
+        --alive;
+    }
+
+    int value;
+};
+
+}  // namespace
+
+TEST_CASE("Relocating with a throwing copy") {
+    {
+        RelocatingVector<FragileCopy> values;
+        values.Reserve(4);
+        for (int i = 0; i < 4; ++i) {
+            values.EmplaceBack(i);
+        }
+        FragileCopy::copies_left = 2;
+        REQUIRE_THROWS_AS(values.Reserve(8), std::runtime_error);
+        REQUIRE(FragileCopy::alive == 4);
+        REQUIRE(values.Capacity() == 4);
+        REQUIRE(values.Size() == 4);
+        REQUIRE(values[3].value == 3);
+    }
+    REQUIRE(FragileCopy::alive == 0);
+}
@@ -0,0 +1,67 @@
+#include "snapshot.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Snapshot basic") {
+    Snapshot<std::string> config(MakeShared<std::string>("v1"));
+    auto reader = config.MakeReader();
+    REQUIRE(*reader == "v1");
+    REQUIRE(reader->size() == 2);
+
+    SharedPtr<const std::string> old = config.Load();
+    REQUIRE(old.UseCount() == 3);
+
+    config.Emplace("v2");
+    REQUIRE(config.Version() == 1);
+    REQUIRE(*old == "v1");
+    REQUIRE(old.UseCount() == 2);
+    REQUIRE(*reader == "v2");
+    REQUIRE(reader.Version() == 1);
+    REQUIRE(old.UseCount() == 1);
+}
+
+TEST_CASE("Snapshot reads do not count") {
+    Snapshot<int> value(MakeShared<int>(1));
+    auto reader = value.MakeReader();
+    REQUIRE(*reader == 1);
+    size_t before = value.Load().UseCount();
+    for (int i = 0; i < 10; ++i) {
+        REQUIRE(*reader == 1);
+    }
+    REQUIRE(value.Load().UseCount() == before);
+}
+
+TEST_CASE("Snapshot across threads") {
+    constexpr int kVersions = 1000;
+    Snapshot<int> value(MakeShared<int>(0));
+    std::atomic<int> regressions = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            auto reader = value.MakeReader();
+            int last = 0;
+            while (last != kVersions) {
+                int current = *reader;
+                if (current < last) {
+                    ++regressions;
+                }
+                last = current;
+            }
+        });
+    }
+    for (int i = 1; i <= kVersions; ++i) {
+        value.Emplace(i);
+    }
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    REQUIRE(regressions == 0);
+    REQUIRE(value.Load().UseCount() == 2);
+}
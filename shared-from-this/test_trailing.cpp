@@ -0,0 +1,94 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Interned string: header and characters in one block
+class InternedString {
+public:
+    InternedString(std::span<char> chars, std::string_view text, size_t hash)
+        : chars_(chars), hash_(hash) {
+        std::memcpy(chars.data(), text.data(), text.size());
+    }
+
+    std::string_view View() const {
+        return {chars_.data(), chars_.size()};
+    }
+
+    size_t Hash() const {
+        return hash_;
+    }
+
+private:
+    std::span<char> chars_;
+    size_t hash_;
+};
+
+struct Polygon {
+    explicit Polygon(std::span<MyInt> points) : points(points) {
+    }
+
+    std::span<MyInt> points;
+};
+
+struct alignas(32) Wide {
+    double values[4] = {};
+};
+
+}  // namespace
+
+TEST_CASE("Trailing storage") {
+    SECTION("One allocation") {
+        std::string_view text = "interned string longer than any small buffer";
+        SharedPtr<InternedString> str;
+        EXPECT_ONE_ALLOCATION(
+            str = MakeSharedWithTrailing<InternedString, char>(text.size(), text, 42));
+        REQUIRE(str->View() == text);
+        REQUIRE(str->Hash() == 42);
+        REQUIRE(reinterpret_cast<const std::byte*>(str->View().data()) >=
+                reinterpret_cast<const std::byte*>(str.Get() + 1));
+    }
+
+    SECTION("Elements live with the object") {
+        WeakPtr<Polygon> weak;
+        {
+            auto polygon = MakeSharedWithTrailing<Polygon, MyInt>(5);
+            weak = polygon;
+            REQUIRE(polygon->points.size() == 5);
+            REQUIRE(MyInt::AliveCount() == 5);
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Aligned elements") {
+        struct Header {
+            explicit Header(std::span<Wide> wides) : wides(wides) {
+            }
+
+            std::span<Wide> wides;
+        };
+        auto header = MakeSharedWithTrailing<Header, Wide>(3);
+        REQUIRE(reinterpret_cast<uintptr_t>(header->wides.data()) % 32 == 0);
+        REQUIRE(header->wides[2].values[3] == 0);
+    }
+
+    SECTION("Too large") {
+        REQUIRE_THROWS_AS((MakeSharedWithTrailing<Polygon, MyInt>(SIZE_MAX / sizeof(MyInt))),
+                          std::bad_array_new_length);
+    }
+}
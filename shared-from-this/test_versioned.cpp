@@ -0,0 +1,121 @@
+#include "versioned.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Versioned basic") {
+    VersionClock clock;
+    Versioned<std::string> name(clock, "first");
+
+    auto old_view = clock.Pin();
+    name.Commit("second");
+    REQUIRE(clock.Now() == 1);
+    REQUIRE(name.Read(old_view) == "first");
+    REQUIRE(name.Read(clock.Pin()) == "second");
+
+    name.Commit("third");
+    REQUIRE(name.Read(old_view) == "first");
+    REQUIRE(name.ChainLength() == 3);
+}
+
+TEST_CASE("Versioned pruning") {
+    VersionClock clock;
+    Versioned<int> value(clock, 0);
+    {
+        auto view = clock.Pin();
+        for (int i = 1; i <= 10; ++i) {
+            value.Commit(i);
+        }
+        REQUIRE(value.Read(view) == 0);
+        REQUIRE(value.ChainLength() == 11);
+    }
+    value.Commit(11);
+    // The last published version stays until the commit is visible
+    REQUIRE(value.ChainLength() == 2);
+    REQUIRE(value.Read(clock.Pin()) == 11);
+}
+
+TEST_CASE("Versioned long chains") {
+    constexpr int kCommits = 50000;
+    VersionClock clock;
+
+    SECTION("Pruned after a long pin") {
+        Versioned<int> value(clock, 0);
+        {
+            auto view = clock.Pin();
+            for (int i = 1; i <= kCommits; ++i) {
+                value.Commit(i);
+            }
+            REQUIRE(value.Read(view) == 0);
+        }
+        value.Commit(kCommits + 1);
+        REQUIRE(value.ChainLength() == 2);
+    }
+
+    SECTION("Destroyed whole") {
+        auto view = clock.Pin();
+        Versioned<int> value(clock, 0);
+        for (int i = 1; i <= kCommits; ++i) {
+            value.Commit(i);
+        }
+        REQUIRE(value.ChainLength() == kCommits + 1);
+    }
+}
+
+TEST_CASE("Versioned transactions") {
+    VersionClock clock;
+    Versioned<int> from(clock, 100);
+    Versioned<int> to(clock, 0);
+
+    auto before = clock.Pin();
+    {
+        auto transaction = clock.Begin();
+        from.Commit(transaction, 70);
+        auto during = clock.Pin();
+        REQUIRE(from.Read(during) == 100);
+        to.Commit(transaction, 30);
+        REQUIRE(to.Read(during) == 0);
+    }
+    auto after = clock.Pin();
+    REQUIRE(from.Read(before) + to.Read(before) == 100);
+    REQUIRE(from.Read(after) == 70);
+    REQUIRE(to.Read(after) == 30);
+}
+
+TEST_CASE("Versioned across threads") {
+    VersionClock clock;
+    Versioned<int> from(clock, 1000);
+    Versioned<int> to(clock, 0);
+    std::atomic<bool> done = false;
+    std::atomic<int> inconsistent = 0;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while (!done) {
+                auto view = clock.Pin();
+                if (from.Read(view) + to.Read(view) != 1000) {
+                    ++inconsistent;
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 1000; ++i) {
+        auto transaction = clock.Begin();
+        from.Commit(transaction, 1000 - i);
+        to.Commit(transaction, i);
+    }
+    done = true;
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    REQUIRE(inconsistent == 0);
+    from.Commit(0);
+    REQUIRE(from.ChainLength() == 2);
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+
+// Commit timestamps for a group of `Versioned` objects. Readers pin a timestamp and see
+// every object as of that commit; writers commit to several objects in one transaction
+class VersionClock {
+public:
+    // Pinned timestamp. Versions visible at it are kept alive until the view is destroyed
+    class ReadView {
+    public:
+        ReadView(ReadView&& other) noexcept
+            : clock_(std::exchange(other.clock_, nullptr)), timestamp_(other.timestamp_) {
+        }
+
+        ReadView& operator=(ReadView&&) = delete;
+
+        ~ReadView() {
+            if (clock_) {
+                clock_->Unpin(timestamp_);
+            }
+        }
+
+        uint64_t Timestamp() const {
+            return timestamp_;
+        }
+
+    private:
+        friend class VersionClock;
+
+        ReadView(VersionClock* clock, uint64_t timestamp) : clock_(clock), timestamp_(timestamp) {
+        }
+
+        VersionClock* clock_;
+        uint64_t timestamp_;
+    };
+
+    // Transactions are serialized. Everything committed in one becomes visible at once,
+    // when the transaction is destroyed
+    class Transaction {
+    public:
+        Transaction(Transaction&& other) noexcept
+            : clock_(std::exchange(other.clock_, nullptr)),
+              lock_(std::move(other.lock_)),
+              timestamp_(other.timestamp_) {
+        }
+
+        Transaction& operator=(Transaction&&) = delete;
+
+        ~Transaction() {
+            if (clock_) {
+                clock_->Publish(timestamp_);
+            }
+        }
+
+        uint64_t Timestamp() const {
+            return timestamp_;
+        }
+
+        VersionClock& Clock() const {
+            return *clock_;
+        }
+
+    private:
+        friend class VersionClock;
+
+        explicit Transaction(VersionClock* clock)
+            : clock_(clock), lock_(clock->commit_mutex_), timestamp_(clock->Now() + 1) {
+        }
+
+        VersionClock* clock_;
+        std::unique_lock<std::mutex> lock_;
+        uint64_t timestamp_;
+    };
+
+    VersionClock() = default;
+
+    VersionClock(const VersionClock&) = delete;
+    VersionClock& operator=(const VersionClock&) = delete;
+
+    ReadView Pin() {
+        std::lock_guard lock(mutex_);
+        uint64_t timestamp = now_.load(std::memory_order_relaxed);
+        ++pins_[timestamp];
+        return ReadView(this, timestamp);
+    }
+
+    Transaction Begin() {
+        return Transaction(this);
+    }
+
+    // Last visible commit
+    uint64_t Now() const {
+        return now_.load(std::memory_order_acquire);
+    }
+
+    // No reader can ask for anything older than this
+    uint64_t OldestPinned() const {
+        std::lock_guard lock(mutex_);
+        return pins_.empty() ? now_.load(std::memory_order_relaxed) : pins_.begin()->first;
+    }
+
+private:
+    void Unpin(uint64_t timestamp) {
+        std::lock_guard lock(mutex_);
+        auto it = pins_.find(timestamp);
+        if (--it->second == 0) {
+            pins_.erase(it);
+        }
+    }
+
+    void Publish(uint64_t timestamp) {
+        std::lock_guard lock(mutex_);
+        now_.store(timestamp, std::memory_order_release);
+    }
+
+    mutable std::mutex mutex_;
+    std::mutex commit_mutex_;
+    std::map<uint64_t, size_t> pins_;
+    std::atomic<uint64_t> now_ = 0;
+};
+
+// Multi-version object: a chain of immutable versions, newest first, linked by `SharedPtr`.
+// Commits prune the chain below the version the oldest pinned reader sees, and the cut
+// off versions are destroyed as their last reference goes away
+template <typename T>
+class Versioned {
+    struct Version {
+        template <typename... Args>
+        Version(uint64_t timestamp, SharedPtr<Version> prev, Args&&... args)
+            : value(std::forward<Args>(args)...), timestamp(timestamp), prev(std::move(prev)) {
+        }
+
+        const T value;
+        const uint64_t timestamp;
+        // Only the committer resets it, and only below every pinned reader
+        SharedPtr<Version> prev;
+    };
+
+public:
+    // The initial value is visible at every timestamp
+    template <typename... Args>
+    explicit Versioned(VersionClock& clock, Args&&... args)
+        : clock_(&clock), head_(MakeShared<Version>(0, nullptr, std::forward<Args>(args)...)) {
+    }
+
+    Versioned(const Versioned&) = delete;
+    Versioned& operator=(const Versioned&) = delete;
+
+    ~Versioned() {
+        ReleaseChain(std::move(head_));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Readers
+
+    // Value as of the view's timestamp, valid while the view is alive
+    const T& Read(const VersionClock::ReadView& view) const {
+        SharedPtr<Version> head;
+        {
+            std::lock_guard lock(mutex_);
+            head = head_;
+        }
+        const Version* version = head.Get();
+        while (version->timestamp > view.Timestamp()) {
+            version = version->prev.Get();
+        }
+        return version->value;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Writers
+
+    // Pruned versions are destroyed after the lock is released, so readers don't wait
+    // for their destructors
+    template <typename... Args>
+    void Commit(VersionClock::Transaction& transaction, Args&&... args) {
+        SharedPtr<Version> pruned;
+        {
+            std::lock_guard lock(mutex_);
+            head_ =
+                MakeShared<Version>(transaction.Timestamp(), head_, std::forward<Args>(args)...);
+            pruned = Prune(transaction.Clock().OldestPinned());
+        }
+        ReleaseChain(std::move(pruned));
+    }
+
+    template <typename... Args>
+    void Commit(Args&&... args) {
+        auto transaction = clock_->Begin();
+        Commit(transaction, std::forward<Args>(args)...);
+    }
+
+    size_t ChainLength() const {
+        std::lock_guard lock(mutex_);
+        size_t length = 0;
+        for (const Version* version = head_.Get(); version; version = version->prev.Get()) {
+            ++length;
+        }
+        return length;
+    }
+
+private:
+    // Readers stop at the first version not newer than their timestamp, so nobody
+    // follows `prev` of the version the oldest reader sees. Returns the cut off tail
+    SharedPtr<Version> Prune(uint64_t oldest) {
+        Version* version = head_.Get();
+        while (version->timestamp > oldest) {
+            version = version->prev.Get();
+        }
+        return std::move(version->prev);
+    }
+
+    // Unlinks the chain one version at a time: dropping it whole would destroy each version
+    // from inside its successor's destructor, one stack frame per version. A version someone
+    // else still holds is left to them, together with the rest of the chain
+    static void ReleaseChain(SharedPtr<Version> chain) {
+        while (chain && chain.IsUnique()) {
+            SharedPtr<Version> prev = std::move(chain->prev);
+            chain = std::move(prev);
+        }
+    }
+
+    VersionClock* clock_;
+    mutable std::mutex mutex_;
+    SharedPtr<Version> head_;
+};
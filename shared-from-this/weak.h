@@ -2,6 +2,10 @@
 
 #include "sw_fwd.h"  // Forward declaration
 #include "shared.h"
+#include <common/pointer_hash.h>
+#include <common/relocatable.h>
+#include <functional>
+
 // https://en.cppreference.com/w/cpp/memory/weak_ptr
 template <typename T>
 class WeakPtr {
@@ -37,7 +41,7 @@ public:
         }
     }
 
-    WeakPtr(WeakPtr&& other) {
+    WeakPtr(WeakPtr&& other) noexcept {
         control_block_ = other.control_block_;
         ptr_ = other.ptr_;
         other.control_block_ = nullptr;
@@ -74,7 +78,7 @@ public:
         return *this;
     }
 
-    WeakPtr& operator=(WeakPtr&& other) {
+    WeakPtr& operator=(WeakPtr&& other) noexcept {
         if (this == &other) {
             return *this;
         }
@@ -102,7 +106,7 @@ public:
         ptr_ = nullptr;
     }
 
-    void Swap(WeakPtr& other) {
+    void Swap(WeakPtr& other) noexcept {
         std::swap(control_block_, other.control_block_);
         std::swap(ptr_, other.ptr_);
     }
@@ -125,24 +129,118 @@ public:
     }
 
     SharedPtr<T> Lock() const {
-        if (control_block_ == nullptr || Expired()) {
-            return SharedPtr<T>();
+        SharedPtr<T> result;
+        if (control_block_ && control_block_->TryAddReference()) {
+            result.control_block_ = control_block_;
+            result.ptr_ = ptr_;
+        }
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Owner-based comparison
+    // https://en.cppreference.com/w/cpp/memory/weak_ptr/owner_before
+
+    template <class Y>
+    bool OwnerBefore(const WeakPtr<Y>& other) const {
+        return std::less<const ControlBlockBase*>()(control_block_, other.control_block_);
+    }
+
+    template <class Y>
+    bool OwnerBefore(const SharedPtr<Y>& other) const {
+        return std::less<const ControlBlockBase*>()(control_block_, other.control_block_);
+    }
+
+    template <class Y>
+    bool OwnerEqual(const WeakPtr<Y>& other) const {
+        return control_block_ == other.control_block_;
+    }
+
+    template <class Y>
+    bool OwnerEqual(const SharedPtr<Y>& other) const {
+        return control_block_ == other.control_block_;
+    }
+
+    // Stays the same after expiry, so `WeakPtr` can be a hash key without locking it
+    size_t OwnerHash() const {
+        return MixPointer(control_block_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Expiry notification
+
+    // Same as `SharedPtr::OnExpire`; an already expired pointer runs `callback` immediately.
+    // Registration holds a strong reference, so it can't race with the last release
+    void OnExpire(ExpiryHooks::Callback callback) const {
+        SharedPtr<T> alive = Lock();
+        if (!alive) {
+            callback();
+            return;
         }
-        return SharedPtr<T>(*this);
+        alive.OnExpire(std::move(callback));
+    }
+
+    template <typename Token>
+    void OnExpire(ExpiryQueue<Token>& queue, Token token) const {
+        OnExpire([&queue, token = std::move(token)]() mutable { queue.Push(std::move(token)); });
     }
 
 private:
     void TryDeleteBlock() {
         if (control_block_) {
-            if (control_block_->GetRefCounter() == 0 && control_block_->GetWeakRefCounter() == 1) {
-                delete control_block_;
-                return;
-            } else {
-                control_block_->DecWeakRef();
-            }
+            control_block_->DecWeakRef();
         }
     }
 
     T* ptr_;
     ControlBlockBase* control_block_;
 };
+
+// Owner-based functors for ordered and hashed containers of `SharedPtr` and `WeakPtr`,
+// mixed freely: `std::set<WeakPtr<T>, OwnerBefore>`, `std::unordered_set<WeakPtr<T>, OwnerHash,
+// OwnerEqual>`
+struct OwnerBefore {
+    using is_transparent = void;
+
+    template <class A, class B>
+    bool operator()(const A& left, const B& right) const {
+        return left.OwnerBefore(right);
+    }
+};
+
+struct OwnerEqual {
+    using is_transparent = void;
+
+    template <class A, class B>
+    bool operator()(const A& left, const B& right) const {
+        return left.OwnerEqual(right);
+    }
+};
+
+struct OwnerHash {
+    using is_transparent = void;
+
+    template <class A>
+    size_t operator()(const A& ptr) const {
+        return ptr.OwnerHash();
+    }
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
+
+// `WeakPtr` has no stable `Get()`, so it compares and hashes by owner like `OwnerEqual` and
+// `OwnerHash`, which lets `std::unordered_set<WeakPtr<T>>` work with the default arguments.
+// `SharedPtr` compares and hashes by `Get()` instead, so the two must not be mixed in one
+// container or lookup without the owner-based functors: an aliasing `SharedPtr` would miss
+template <typename T, typename U>
+inline bool operator==(const WeakPtr<T>& left, const WeakPtr<U>& right) {
+    return left.OwnerEqual(right);
+}
+
+template <typename T>
+struct std::hash<WeakPtr<T>> {
+    size_t operator()(const WeakPtr<T>& ptr) const {
+        return ptr.OwnerHash();
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "unique.h"
+
+#include <common/array_bytes.h>
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+
+// Arrays whose start is aligned to `Align` bytes, for vectorized loops. The deleter carries
+// the length: it destroys the elements and gives the memory back to aligned `operator new`
+template <typename T, size_t Align = 64>
+class AlignedDeleter {
+    static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0, "Bad alignment");
+
+public:
+    static constexpr size_t kAlignment = Align;
+
+    AlignedDeleter() = default;
+
+    explicit AlignedDeleter(size_t size) : size_(size) {
+    }
+
+    void operator()(T* ptr) const {
+        if (ptr) {
+            std::destroy_n(ptr, size_);
+            ::operator delete(ptr, std::align_val_t(Align));
+        }
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    size_t size_ = 0;
+};
+
+// Arrays in their own anonymous mapping, aligned to a 2 MiB huge page, so the kernel
+// can back them with huge pages and the TLB covers them with few entries
+template <typename T>
+class HugePageDeleter {
+public:
+    static constexpr size_t kAlignment = size_t{2} << 20;
+
+    HugePageDeleter() = default;
+
+    explicit HugePageDeleter(size_t size) : size_(size) {
+    }
+
+    void operator()(T* ptr) const {
+        if (ptr) {
+            std::destroy_n(ptr, size_);
+            munmap(ptr, MappedBytes(size_));
+        }
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // Throws `std::bad_array_new_length` if the size does not fit in `size_t`
+    static size_t MappedBytes(size_t size) {
+        return ArrayBytes(size, sizeof(T), 0, kAlignment);
+    }
+
+private:
+    size_t size_ = 0;
+};
+
+template <typename T, size_t Align = 64>
+using AlignedArray = UniquePtr<T[], AlignedDeleter<T, Align>>;
+
+template <typename T>
+using HugePageArray = UniquePtr<T[], HugePageDeleter<T>>;
+
+// `MakeUniqueAligned<float[]>(n)`: `n` value-initialized elements, the first one aligned
+// to `Align` bytes. Throws `std::bad_array_new_length` if `n` elements do not fit in memory
+template <typename T, size_t Align = 64>
+    requires std::is_unbounded_array_v<T>
+AlignedArray<std::remove_extent_t<T>, Align> MakeUniqueAligned(size_t size) {
+    using Elem = std::remove_extent_t<T>;
+    auto* data = static_cast<Elem*>(::operator new(ArrayBytes(size, sizeof(Elem)), std::align_val_t(Align)));
+    try {
+        std::uninitialized_value_construct_n(data, size);
+    } catch (...) {
+        ::operator delete(data, std::align_val_t(Align));
+        throw;
+    }
+    return AlignedArray<Elem, Align>(data, AlignedDeleter<Elem, Align>(size));
+}
+
+// `MakeUniqueHuge<float[]>(n)`: like `MakeUniqueAligned`, in a huge-page aligned mapping.
+// Throws `std::bad_alloc` if the mapping fails and `std::bad_array_new_length` if `n`
+// elements do not fit in memory
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+HugePageArray<std::remove_extent_t<T>> MakeUniqueHuge(size_t size) {
+    using Elem = std::remove_extent_t<T>;
+    using Deleter = HugePageDeleter<Elem>;
+    size_t bytes = Deleter::MappedBytes(size);
+    if (bytes == 0) {
+        return HugePageArray<Elem>(nullptr, Deleter(0));
+    }
+
+    // Map one extra huge page and trim both ends to get an aligned start
+    size_t padded = ArrayBytes(size, sizeof(Elem), Deleter::kAlignment, Deleter::kAlignment);
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    auto start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + Deleter::kAlignment - 1) & ~(Deleter::kAlignment - 1);
+    if (aligned != start) {
+        munmap(raw, aligned - start);
+    }
+    munmap(reinterpret_cast<void*>(aligned + bytes), start + padded - aligned - bytes);
+#ifdef MADV_HUGEPAGE
+    madvise(reinterpret_cast<void*>(aligned), bytes, MADV_HUGEPAGE);  // Only a hint
+#endif
+
+    auto* data = reinterpret_cast<Elem*>(aligned);
+    // Fresh anonymous pages are zero-filled already
+    if constexpr (!std::is_trivially_default_constructible_v<Elem>) {
+        try {
+            std::uninitialized_value_construct_n(data, size);
+        } catch (...) {
+            munmap(data, bytes);
+            throw;
+        }
+    }
+    return HugePageArray<Elem>(data, Deleter(size));
+}
+
+// Whole buffer as a span. The compiler is told about the alignment, so loops over it
+// can use aligned vector loads without a peeled prologue
+template <typename T, typename Deleter>
+    requires requires { Deleter::kAlignment; }
+std::span<T> Span(const UniquePtr<T[], Deleter>& array) {
+    if (!array) {
+        return {};
+    }
+    return {std::assume_aligned<Deleter::kAlignment>(array.Get()), array.GetDeleter().Size()};
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "unique.h"
+
+#include <common/monotonic_arena.h>
+
+#include <utility>
+
+// Runs the destructor and leaves the memory to the arena. Empty, so an arena `UniquePtr`
+// is one pointer wide and converts to `UniquePtr<Base, ArenaDeleter>` like a plain one
+struct ArenaDeleter {
+    template <typename T>
+    void operator()(T* ptr) const {
+        ptr->~T();
+    }
+};
+
+template <typename T>
+using ArenaPtr = UniquePtr<T, ArenaDeleter>;
+
+// The object must be destroyed before `arena` is reset
+template <typename T, typename... Args>
+ArenaPtr<T> MakeArenaUnique(MonotonicArena& arena, Args&&... args) {
+    return ArenaPtr<T>(new (arena.Allocate<T>()) T(std::forward<Args>(args)...));
+}
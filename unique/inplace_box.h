@@ -0,0 +1,183 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t, std::max_align_t
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Owner of a polymorphic object, like `UniquePtr<Base>`, that keeps small derived objects
+// inside itself and puts the rest on the heap. Mirrors `UniquePtr`: `Get`, `Reset`,
+// `Extract` (the `Release` of a box, since an inline object has to move out first)
+template <typename Base, size_t Capacity = 64, size_t Align = alignof(std::max_align_t)>
+class InplaceBox {
+    static_assert(Capacity > 0, "use UniquePtr for heap-only storage");
+
+    // Per-type operations, chosen at construction, when the concrete type is known
+    struct Ops {
+        void (*destroy)(Base* object);
+        // Move the object into `storage`, or keep it in place if it lives on the heap
+        Base* (*relocate)(Base* object, void* storage);
+        // Move the object to the heap, or just hand it over if it is there already
+        Base* (*extract)(Base* object);
+    };
+
+    template <typename D>
+    static constexpr bool kFitsInline = sizeof(D) <= Capacity && alignof(D) <= Align &&
+                                        std::is_nothrow_move_constructible_v<D>;
+
+    template <typename D>
+    static constexpr Ops kInlineOps = {
+        [](Base* object) { static_cast<D*>(object)->~D(); },
+        [](Base* object, void* storage) -> Base* {
+            D* source = static_cast<D*>(object);
+            D* moved = new (storage) D(std::move(*source));
+            source->~D();
+            return moved;
+        },
+        [](Base* object) -> Base* {
+            D* source = static_cast<D*>(object);
+            D* moved = new D(std::move(*source));
+            source->~D();
+            return moved;
+        },
+    };
+
+    template <typename D>
+    static constexpr Ops kHeapOps = {
+        [](Base* object) { delete static_cast<D*>(object); },
+        [](Base* object, void*) { return object; },
+        [](Base* object) { return object; },
+    };
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    InplaceBox() = default;
+
+    InplaceBox(std::nullptr_t) {
+    }
+
+    template <typename D, typename... Args>
+    explicit InplaceBox(std::in_place_type_t<D>, Args&&... args) {
+        Emplace<D>(std::forward<Args>(args)...);
+    }
+
+    // Adopts a heap object as is
+    template <typename D>
+    InplaceBox(UniquePtr<D>&& other) noexcept {
+        if (other) {
+            ops_ = &kHeapOps<D>;
+            ptr_ = other.Release();
+        }
+    }
+
+    InplaceBox(InplaceBox&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    InplaceBox(const InplaceBox&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    InplaceBox& operator=(InplaceBox&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceBox& operator=(const InplaceBox&) = delete;
+
+    InplaceBox& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~InplaceBox() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    template <typename D, typename... Args>
+    D& Emplace(Args&&... args) {
+        static_assert(std::is_base_of_v<Base, D>, "D must derive from Base");
+        Reset();
+        D* object;
+        if constexpr (kFitsInline<D>) {
+            object = new (storage_) D(std::forward<Args>(args)...);
+            ops_ = &kInlineOps<D>;
+        } else {
+            object = new D(std::forward<Args>(args)...);
+            ops_ = &kHeapOps<D>;
+        }
+        ptr_ = object;
+        return *object;
+    }
+
+    void Reset() noexcept {
+        if (ptr_) {
+            ops_->destroy(std::exchange(ptr_, nullptr));
+            ops_ = nullptr;
+        }
+    }
+
+    // Ownership passes to the caller; an inline object is moved to the heap first
+    UniquePtr<Base> Extract() {
+        static_assert(std::has_virtual_destructor_v<Base>,
+                      "UniquePtr<Base> can only delete derived objects through a virtual destructor");
+        if (!ptr_) {
+            return UniquePtr<Base>();
+        }
+        UniquePtr<Base> result(ops_->extract(ptr_));
+        ptr_ = nullptr;
+        ops_ = nullptr;
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    Base* Get() const {
+        return ptr_;
+    }
+
+    Base& operator*() const {
+        return *ptr_;
+    }
+
+    Base* operator->() const {
+        return ptr_;
+    }
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+    bool IsInline() const {
+        std::less<const void*> less;
+        return ptr_ && !less(ptr_, storage_) && less(ptr_, storage_ + Capacity);
+    }
+
+private:
+    void MoveFrom(InplaceBox& other) noexcept {
+        if (other.ptr_) {
+            ptr_ = other.ops_->relocate(std::exchange(other.ptr_, nullptr), storage_);
+            ops_ = std::exchange(other.ops_, nullptr);
+        }
+    }
+
+    Base* ptr_ = nullptr;
+    const Ops* ops_ = nullptr;
+    alignas(Align) std::byte storage_[Capacity];
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "unique.h"
+
+#include <common/array_bytes.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// When to split work on an array across threads
+struct ParallelArrayPolicy {
+    // Arrays shorter than this, and every chunk, are handled on one thread
+    size_t threshold = size_t{1} << 16;
+    // 0 means `std::thread::hardware_concurrency()`
+    size_t max_threads = 0;
+
+    size_t ThreadCount(size_t size) const {
+        size_t limit =
+            max_threads ? max_threads : std::max(std::thread::hardware_concurrency(), 1u);
+        return std::clamp<size_t>(size / std::max<size_t>(threshold, 1), 1, limit);
+    }
+};
+
+// Calls `fn(begin, end)` over consecutive chunks of `[0, size)`, the first chunk on the
+// calling thread. Returns the first exception thrown by any chunk, after all have finished
+template <typename Fn>
+std::exception_ptr ParallelChunks(size_t size, const ParallelArrayPolicy& policy, Fn fn) {
+    size_t threads = policy.ThreadCount(size);
+    size_t chunk = (size + threads - 1) / std::max<size_t>(threads, 1);
+    std::vector<std::exception_ptr> errors(threads);
+    auto run = [&](size_t index) {
+        try {
+            fn(std::min(size, index * chunk), std::min(size, (index + 1) * chunk));
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        try {
+            workers.emplace_back(run, i);
+        } catch (const std::system_error&) {
+            run(i);  // Out of threads: do the chunk here
+        }
+    }
+    run(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (auto& error : errors) {
+        if (error) {
+            return error;
+        }
+    }
+    return nullptr;
+}
+
+// Throws `std::bad_array_new_length` if `size` elements do not fit in memory
+template <typename T>
+T* AllocateArrayStorage(size_t size) {
+    size_t bytes = ArrayBytes(size, sizeof(T));
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        return static_cast<T*>(::operator new(bytes, std::align_val_t(alignof(T))));
+    } else {
+        return static_cast<T*>(::operator new(bytes));
+    }
+}
+
+template <typename T>
+void DeallocateArrayStorage(T* ptr) {
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        ::operator delete(ptr, std::align_val_t(alignof(T)));
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+// Deleter for arrays made by `MakeParallelArray`: runs the element destructors on several
+// threads, then frees the storage. Carries the length, which `delete[]` would keep itself.
+// Works for shared arrays too: `SharedPtr<T>(ptr.Release(), std::move(ptr.GetDeleter()))`
+template <typename T>
+class ParallelArrayDeleter {
+public:
+    ParallelArrayDeleter() = default;
+
+    explicit ParallelArrayDeleter(size_t size, ParallelArrayPolicy policy = {})
+        : size_(size), policy_(policy) {
+    }
+
+    void operator()(T* ptr) const {
+        if (!ptr) {
+            return;
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            // Destructors don't throw, so no chunk can fail
+            ParallelChunks(size_, policy_, [ptr](size_t begin, size_t end) {
+                std::destroy(ptr + begin, ptr + end);
+            });
+        }
+        DeallocateArrayStorage(ptr);
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    size_t size_ = 0;
+    ParallelArrayPolicy policy_;
+};
+
+// Array of `size` elements, each constructed as `T(args...)` (value-initialized without
+// `args`), on several threads. If any constructor throws, every element built so far
+// is destroyed and the first exception is rethrown
+template <typename T, typename... Args>
+UniquePtr<T[], ParallelArrayDeleter<T>> MakeParallelArray(ParallelArrayPolicy policy, size_t size,
+                                                          const Args&... args) {
+    T* data = AllocateArrayStorage<T>(size);
+    std::vector<size_t> built(policy.ThreadCount(size));
+    size_t chunk = (size + built.size() - 1) / built.size();
+    auto error = ParallelChunks(size, policy, [&](size_t begin, size_t end) {
+        size_t& count = built[begin / std::max<size_t>(chunk, 1)];
+        for (size_t i = begin; i < end; ++i, ++count) {
+            new (data + i) T(args...);
+        }
+    });
+    if (error) {
+        for (size_t i = 0; i < built.size(); ++i) {
+            std::destroy_n(data + std::min(size, i * chunk), built[i]);
+        }
+        DeallocateArrayStorage(data);
+        std::rethrow_exception(error);
+    }
+    return UniquePtr<T[], ParallelArrayDeleter<T>>(data, ParallelArrayDeleter<T>(size, policy));
+}
+
+template <typename T, typename... Args>
+UniquePtr<T[], ParallelArrayDeleter<T>> MakeParallelArray(size_t size, const Args&... args) {
+    return MakeParallelArray<T>(ParallelArrayPolicy{}, size, args...);
+}
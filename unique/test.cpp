@@ -3,10 +3,14 @@
 #include "deleters.h"
 
 #include <common/my_int.h>
+#include <common/relocating_vector.h>
 
 #include <catch.hpp>
+#include <cstdio>
+#include <string>
 #include <vector>
 #include <tuple>
+#include <unordered_set>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -464,6 +468,38 @@ TEST_CASE("Compressed pair usage") {
     }
 }
 
+struct EmptyA {};
+struct EmptyB {};
+struct FinalEmpty final {};
+
+TEST_CASE("Compressed tuple") {
+    SECTION("Empty members take no space") {
+        static_assert(sizeof(CompressedTuple<int*, EmptyA, EmptyB>) == sizeof(int*));
+        static_assert(sizeof(CompressedTuple<EmptyA, int*, EmptyB>) == sizeof(int*));
+        static_assert(sizeof(CompressedTuple<int*, FinalEmpty>) == sizeof(std::pair<int*, FinalEmpty>));
+    }
+
+    SECTION("Duplicate empty types") {
+        CompressedTuple<EmptyA, EmptyA, int*> tuple;
+        REQUIRE(static_cast<void*>(&tuple.Get<0>()) != static_cast<void*>(&tuple.Get<1>()));
+    }
+
+    SECTION("Constexpr") {
+        constexpr CompressedTuple<int, EmptyA, long> kTuple(1, EmptyA(), 3L);
+        static_assert(kTuple.Get<0>() == 1);
+        static_assert(kTuple.Get<2>() == 3);
+    }
+
+    SECTION("Trailing members") {
+        std::string str = "abacaba";
+        CompressedTuple<std::string, EmptyA, std::string> tuple(std::move(str));
+        REQUIRE(tuple.Get<0>() == "abacaba");
+        REQUIRE(tuple.Get<2>().empty());
+        tuple.Get<2>() = "x";
+        REQUIRE(std::as_const(tuple).Get<2>() == "x");
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template <typename T>
@@ -504,3 +540,101 @@ TEST_CASE("Upcasts") {
         s2 = std::move(s);
     }
 }
+
+TEST_CASE("Hash") {
+    std::unordered_set<UniquePtr<int>> set;
+    int* raw = new int(5);
+    set.emplace(raw);
+    set.emplace(new int(6));
+    REQUIRE(set.size() == 2);
+
+    UniquePtr<int> copy(raw);
+    REQUIRE(std::hash<UniquePtr<int>>()(copy) == MixPointer(raw));
+    REQUIRE(set.count(copy) == 1);
+    copy.Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static_assert(sizeof(UniquePtr<FILE, FnDeleter<&fclose>>) == sizeof(void*));
+
+int closed_count = 0;
+
+void CountingClose(FILE* file) {
+    ++closed_count;
+    fclose(file);
+}
+
+TEST_CASE("Compile-time deleters") {
+    SECTION("Function") {
+        closed_count = 0;
+        {
+            UniquePtr<FILE, FnDeleter<&CountingClose>> file(tmpfile());
+            REQUIRE(file);
+            static_assert(sizeof(file) == sizeof(void*));
+        }
+        REQUIRE(closed_count == 1);
+    }
+
+    SECTION("Lambda as a template argument") {
+        {
+            UniquePtr<MyInt, FnDeleter<[](MyInt* ptr) { delete ptr; }>> s(new MyInt);
+            static_assert(sizeof(s) == sizeof(void*));
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Lambda type") {
+        using LambdaDeleter = decltype([](MyInt* ptr) { delete ptr; });
+        {
+            UniquePtr<MyInt, LambdaDeleter> s(new MyInt);
+            UniquePtr<MyInt, LambdaDeleter> s2(std::move(s));
+            s = std::move(s2);
+            static_assert(sizeof(s) == sizeof(void*));
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static_assert(std::is_nothrow_move_constructible_v<UniquePtr<MyInt>>);
+static_assert(std::is_nothrow_move_assignable_v<UniquePtr<MyInt>>);
+static_assert(kIsTriviallyRelocatable<UniquePtr<MyInt>>);
+static_assert(kIsTriviallyRelocatable<UniquePtr<FILE, FnDeleter<&fclose>>>);
+static_assert(!kIsTriviallyRelocatable<UniquePtr<MyInt, Deleter<MyInt>>>);
+
+TEST_CASE("Relocating vector") {
+    SECTION("Relocatable") {
+        {
+            RelocatingVector<UniquePtr<MyInt>> ptrs;
+            for (int i = 0; i < 100; ++i) {
+                ptrs.EmplaceBack(new MyInt(i));
+            }
+            REQUIRE(ptrs.Size() == 100);
+            REQUIRE(MyInt::AliveCount() == 100);
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(*ptrs[i] == i);
+            }
+            ptrs.PopBack();
+            REQUIRE(MyInt::AliveCount() == 99);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Stateful deleter") {
+        {
+            RelocatingVector<UniquePtr<MyInt, Deleter<MyInt>>> ptrs;
+            for (int i = 0; i < 10; ++i) {
+                ptrs.EmplaceBack(new MyInt(i), Deleter<MyInt>(i + 1));
+            }
+            for (int i = 0; i < 10; ++i) {
+                REQUIRE(*ptrs[i] == i);
+                REQUIRE(ptrs[i].GetDeleter().GetTag() == i + 1);
+            }
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
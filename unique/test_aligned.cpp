@@ -0,0 +1,87 @@
+#include "aligned.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static_assert(sizeof(AlignedArray<float>) == sizeof(float*) + sizeof(size_t));
+
+template <typename T>
+bool IsAligned(const T* ptr, size_t align) {
+    return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+}
+
+TEST_CASE("Aligned arrays") {
+    SECTION("Alignment and size") {
+        auto array = MakeUniqueAligned<float[]>(1000);
+        REQUIRE(IsAligned(array.Get(), 64));
+        REQUIRE(array.GetDeleter().Size() == 1000);
+        for (float value : Span(array)) {
+            REQUIRE(value == 0);
+        }
+
+        auto wide = MakeUniqueAligned<double[], 4096>(3);
+        REQUIRE(IsAligned(wide.Get(), 4096));
+    }
+
+    SECTION("Span") {
+        auto array = MakeUniqueAligned<int[]>(100);
+        std::span<int> span = Span(array);
+        REQUIRE(span.size() == 100);
+        std::iota(span.begin(), span.end(), 0);
+        REQUIRE(array[99] == 99);
+
+        array.Reset();
+        REQUIRE(Span(array).empty());
+    }
+
+    SECTION("Non-trivial elements") {
+        auto array = MakeUniqueAligned<std::string[]>(10);
+        array[3] = std::string(100, 'a');
+        REQUIRE(array[9].empty());
+        AlignedArray<std::string> moved(std::move(array));
+        REQUIRE(moved[3] == std::string(100, 'a'));
+    }
+
+    SECTION("Too large") {
+        REQUIRE_THROWS_AS(MakeUniqueAligned<uint64_t[]>(SIZE_MAX / 4), std::bad_array_new_length);
+        REQUIRE_THROWS_AS(MakeUniqueAligned<std::string[]>(SIZE_MAX / 8),
+                          std::bad_array_new_length);
+    }
+}
+
+TEST_CASE("Huge page arrays") {
+    SECTION("Alignment and zeroing") {
+        auto array = MakeUniqueHuge<uint64_t[]>(1000);
+        REQUIRE(IsAligned(array.Get(), size_t{2} << 20));
+        std::span<uint64_t> span = Span(array);
+        REQUIRE(span.size() == 1000);
+        for (uint64_t value : span) {
+            REQUIRE(value == 0);
+        }
+        span.back() = 1;
+    }
+
+    SECTION("Non-trivial elements") {
+        auto array = MakeUniqueHuge<std::string[]>(5);
+        array[4] = std::string(100, 'b');
+        REQUIRE(array[0].empty());
+    }
+
+    SECTION("Empty") {
+        auto array = MakeUniqueHuge<int[]>(0);
+        REQUIRE(!array);
+        REQUIRE(Span(array).empty());
+    }
+
+    SECTION("Too large") {
+        REQUIRE_THROWS_AS(MakeUniqueHuge<uint64_t[]>(SIZE_MAX / 4), std::bad_array_new_length);
+        // Fits on its own, but not with the padding page
+        REQUIRE_THROWS_AS(MakeUniqueHuge<char[]>(SIZE_MAX - (size_t{3} << 20)),
+                          std::bad_array_new_length);
+    }
+}
@@ -0,0 +1,98 @@
+#include "arena.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static_assert(sizeof(ArenaPtr<int>) == sizeof(void*));
+
+TEST_CASE("Monotonic arena") {
+    SECTION("Alignment") {
+        MonotonicArena arena(64);
+        arena.Allocate(1, 1);
+        struct alignas(32) Wide {
+            char data[32];
+        };
+        auto* wide = arena.Allocate<Wide>();
+        REQUIRE(reinterpret_cast<uintptr_t>(wide) % 32 == 0);
+        arena.Allocate(1, 1);
+        REQUIRE(reinterpret_cast<uintptr_t>(arena.Allocate<double>()) % alignof(double) == 0);
+    }
+
+    SECTION("Chunks") {
+        MonotonicArena arena(256);
+        for (int i = 0; i < 1000; ++i) {
+            arena.Allocate(16);
+        }
+        REQUIRE(arena.ChunkCount() < 10);
+        arena.Allocate(100000);
+        arena.Reset();
+        REQUIRE(arena.ChunkCount() == 0);
+        arena.Allocate(16);
+        REQUIRE(arena.ChunkCount() == 1);
+    }
+
+    SECTION("Reset starts small again") {
+        MonotonicArena arena;
+        arena.Allocate(16);
+        size_t capacity = arena.Capacity();
+        for (int cycle = 0; cycle < 1000; ++cycle) {
+            arena.Reset();
+            for (int i = 0; i < 100; ++i) {
+                arena.Allocate(16);
+            }
+            REQUIRE(arena.ChunkCount() == 1);
+            REQUIRE(arena.Capacity() == capacity);
+        }
+    }
+}
+
+TEST_CASE("Arena UniquePtr") {
+    struct Base {
+        virtual ~Base() = default;
+    };
+
+    struct Derived : Base {
+        std::string name = std::string(100, 'a');
+        MyInt counted;
+    };
+
+    MonotonicArena arena;
+
+    SECTION("Destructors run, memory stays") {
+        {
+            auto a = MakeArenaUnique<MyInt>(arena, 42);
+            auto b = MakeArenaUnique<std::string>(arena, "abacaba");
+            REQUIRE(*a == 42);
+            REQUIRE(*b == "abacaba");
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Upcast") {
+        {
+            ArenaPtr<Base> base = MakeArenaUnique<Derived>(arena);
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Many objects, no frees") {
+        {
+            std::vector<ArenaPtr<MyInt>> objects;
+            for (int i = 0; i < 1000; ++i) {
+                objects.push_back(MakeArenaUnique<MyInt>(arena, i));
+            }
+            REQUIRE(MyInt::AliveCount() == 1000);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+        arena.Reset();
+    }
+}
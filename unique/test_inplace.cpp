@@ -0,0 +1,130 @@
+#include "inplace_box.h"
+
+#include <catch.hpp>
+
+#include <array>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Strategy {
+    virtual int Run(int x) const = 0;
+    virtual ~Strategy() = default;
+
+    static inline int alive = 0;
+};
+
+struct AddOne : Strategy {
+    AddOne() {
+        ++alive;
+    }
+
+    AddOne(AddOne&&) noexcept {
+        ++alive;
+    }
+
+    ~AddOne() override {
+        --alive;
+    }
+
+    int Run(int x) const override {
+        return x + 1;
+    }
+};
+
+struct AddMany : Strategy {
+    AddMany(int value) {
+        values.fill(value);
+        ++alive;
+    }
+
+    AddMany(AddMany&& other) noexcept : values(other.values) {
+        ++alive;
+    }
+
+    ~AddMany() override {
+        --alive;
+    }
+
+    int Run(int x) const override {
+        for (int value : values) {
+            x += value;
+        }
+        return x;
+    }
+
+    std::array<int, 64> values;
+};
+
+TEST_CASE("InplaceBox storage") {
+    SECTION("Small objects are inline") {
+        InplaceBox<Strategy> box(std::in_place_type<AddOne>);
+        REQUIRE(box.IsInline());
+        REQUIRE(box->Run(1) == 2);
+        REQUIRE(Strategy::alive == 1);
+    }
+    REQUIRE(Strategy::alive == 0);
+
+    SECTION("Large objects are on the heap") {
+        InplaceBox<Strategy> box(std::in_place_type<AddMany>, 1);
+        REQUIRE(!box.IsInline());
+        REQUIRE(box->Run(0) == 64);
+        REQUIRE(Strategy::alive == 1);
+    }
+    REQUIRE(Strategy::alive == 0);
+
+    SECTION("Adopt UniquePtr") {
+        UniquePtr<AddOne> heap(new AddOne);
+        AddOne* raw = heap.Get();
+        InplaceBox<Strategy> box(std::move(heap));
+        REQUIRE(box.Get() == raw);
+        REQUIRE(!box.IsInline());
+    }
+    REQUIRE(Strategy::alive == 0);
+}
+
+TEST_CASE("InplaceBox modifiers") {
+    SECTION("Move") {
+        InplaceBox<Strategy> a(std::in_place_type<AddOne>);
+        InplaceBox<Strategy> b(std::in_place_type<AddMany>, 2);
+        Strategy* heap = b.Get();
+
+        InplaceBox<Strategy> c(std::move(a));
+        REQUIRE(!a);
+        REQUIRE(c.IsInline());
+        REQUIRE(c->Run(1) == 2);
+
+        a = std::move(b);
+        REQUIRE(a.Get() == heap);
+        REQUIRE(Strategy::alive == 2);
+
+        a = std::move(c);
+        REQUIRE(a.IsInline());
+        REQUIRE(Strategy::alive == 1);
+    }
+    REQUIRE(Strategy::alive == 0);
+
+    SECTION("Emplace and Reset") {
+        InplaceBox<Strategy> box;
+        REQUIRE(!box);
+        box.Emplace<AddMany>(1);
+        box.Emplace<AddOne>();
+        REQUIRE(Strategy::alive == 1);
+        box.Reset();
+        REQUIRE(!box);
+        REQUIRE(Strategy::alive == 0);
+    }
+
+    SECTION("Extract") {
+        InplaceBox<Strategy> box(std::in_place_type<AddOne>);
+        UniquePtr<Strategy> heap = box.Extract();
+        REQUIRE(!box);
+        REQUIRE(heap->Run(2) == 3);
+        REQUIRE(Strategy::alive == 1);
+    }
+    REQUIRE(Strategy::alive == 0);
+
+    SECTION("Sizeof") {
+        static_assert(sizeof(InplaceBox<Strategy, 16, 8>) == 16 + 2 * sizeof(void*));
+    }
+}
@@ -0,0 +1,152 @@
+#include "parallel_array.h"
+
+#include <catch.hpp>
+
+#include <shared-from-this/shared.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::atomic<int> alive = 0;
+
+struct Tracked {
+    Tracked() : value(7) {
+        ++alive;
+    }
+
+    Tracked(int value) : value(value) {
+        ++alive;
+    }
+
+    Tracked(const Tracked&) = delete;
+
+    ~Tracked() {
+        --alive;
+    }
+
+    int value;
+};
+
+std::atomic<int> until_throw = 0;
+
+// Destructor calls per element, indexed by the order the elements were built in
+std::vector<std::atomic<int>> destroyed_at(1000);
+std::atomic<int> next_index = 0;
+
+struct Indexed {
+    Indexed() : index(next_index++) {
+    }
+
+    Indexed(const Indexed&) = delete;
+
+    ~Indexed() {
+        ++destroyed_at[index];
+    }
+
+    int index;
+};
+
+struct ThrowsEventually {
+    ThrowsEventually() {
+        if (until_throw.fetch_sub(1) == 0) {
+            throw std::runtime_error("boom");
+        }
+        ++alive;
+    }
+
+    ~ThrowsEventually() {
+        --alive;
+    }
+};
+
+}  // namespace
+
+static_assert(sizeof(UniquePtr<Tracked[], ParallelArrayDeleter<Tracked>>) ==
+              sizeof(Tracked*) + sizeof(ParallelArrayDeleter<Tracked>));
+
+TEST_CASE("Parallel array") {
+    constexpr ParallelArrayPolicy kPolicy{.threshold = 100, .max_threads = 4};
+
+    SECTION("Single-threaded below the threshold") {
+        REQUIRE(kPolicy.ThreadCount(99) == 1);
+        REQUIRE(kPolicy.ThreadCount(250) == 2);
+        REQUIRE(kPolicy.ThreadCount(100000) == 4);
+        {
+            auto array = MakeParallelArray<Tracked>(kPolicy, 50);
+            REQUIRE(alive == 50);
+            REQUIRE(array[49].value == 7);
+        }
+        REQUIRE(alive == 0);
+    }
+
+    SECTION("Parallel") {
+        {
+            auto array = MakeParallelArray<Tracked>(kPolicy, 1001, 42);
+            REQUIRE(alive == 1001);
+            REQUIRE(array.GetDeleter().Size() == 1001);
+            for (size_t i = 0; i < 1001; ++i) {
+                REQUIRE(array[i].value == 42);
+            }
+        }
+        REQUIRE(alive == 0);
+    }
+
+    SECTION("Strings") {
+        auto array = MakeParallelArray<std::string>(kPolicy, 1000, std::string(100, 'a'));
+        REQUIRE(array[999] == std::string(100, 'a'));
+        array.Reset();
+        REQUIRE(!array);
+    }
+
+    SECTION("Constructor throws") {
+        until_throw = 500;
+        REQUIRE_THROWS_AS(MakeParallelArray<ThrowsEventually>(kPolicy, 1000), std::runtime_error);
+        REQUIRE(alive == 0);
+    }
+
+    SECTION("Move") {
+        auto array = MakeParallelArray<Tracked>(kPolicy, 300);
+        UniquePtr<Tracked[], ParallelArrayDeleter<Tracked>> other(std::move(array));
+        REQUIRE(other.GetDeleter().Size() == 300);
+        other = nullptr;
+        REQUIRE(alive == 0);
+    }
+
+    SECTION("Empty") {
+        auto array = MakeParallelArray<Tracked>(0);
+        REQUIRE(alive == 0);
+    }
+
+    SECTION("Too large") {
+        REQUIRE_THROWS_AS(MakeParallelArray<uint64_t>(kPolicy, SIZE_MAX / 4),
+                          std::bad_array_new_length);
+    }
+
+    SECTION("Shared") {
+        next_index = 0;
+        for (auto& count : destroyed_at) {
+            count = 0;
+        }
+        auto array = MakeParallelArray<Indexed>(kPolicy, destroyed_at.size());
+        SharedPtr<Indexed> shared(array.Release(), std::move(array.GetDeleter()));
+        REQUIRE(!array);
+        {
+            SharedPtr<Indexed> copy = shared;
+            shared.Reset();
+            REQUIRE(copy.UseCount() == 1);
+            REQUIRE(copy.Get()[999].index == 999);
+            for (auto& count : destroyed_at) {
+                REQUIRE(count == 0);
+            }
+        }
+        for (auto& count : destroyed_at) {
+            REQUIRE(count == 1);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#include "unique_any.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("UniqueAny") {
+    SECTION("Sizeof") {
+        static_assert(sizeof(UniqueAny) == 2 * sizeof(void*));
+    }
+
+    SECTION("Checked access") {
+        UniqueAny any = MakeUniqueAny<std::string>("aba");
+        REQUIRE(any.Is<std::string>());
+        REQUIRE(!any.Is<int>());
+        REQUIRE(*any.As<std::string>() == "aba");
+        REQUIRE(any.As<const std::string>() == any.As<std::string>());
+        REQUIRE(any.As<int>() == nullptr);
+
+        const UniqueAny& ref = any;
+        REQUIRE(ref.As<std::string>()->size() == 3);
+
+        UniqueAny empty;
+        REQUIRE(!empty);
+        REQUIRE(empty.As<std::string>() == nullptr);
+    }
+
+    SECTION("Lifetime") {
+        {
+            std::vector<UniqueAny> queue;
+            queue.push_back(MakeUniqueAny<MyInt>(1));
+            queue.push_back(MakeUniqueAny<std::string>("two"));
+            queue.emplace_back(UniquePtr<MyInt>(new MyInt(3)));
+            REQUIRE(MyInt::AliveCount() == 2);
+
+            queue[0] = std::move(queue[1]);
+            REQUIRE(MyInt::AliveCount() == 1);
+            REQUIRE(!queue[1]);
+            REQUIRE(*queue[2].As<MyInt>() == 3);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Move-only payload") {
+        UniqueAny any = MakeUniqueAny<UniquePtr<MyInt>>(new MyInt(4));
+        REQUIRE(MyInt::AliveCount() == 1);
+        REQUIRE(**any.As<UniquePtr<MyInt>>() == 4);
+        any.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
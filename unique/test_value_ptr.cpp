@@ -0,0 +1,93 @@
+#include "value_ptr.h"
+
+#include <catch.hpp>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Shape {
+    virtual double Area() const = 0;
+    virtual void Scale(double factor) = 0;
+
+    // No virtual destructor and no virtual Clone(): ValuePtr remembers the concrete type
+    static inline int alive = 0;
+};
+
+struct Square : Shape {
+    explicit Square(double side) : side(side) {
+        ++alive;
+    }
+
+    Square(const Square& other) : side(other.side) {
+        ++alive;
+    }
+
+    Square(Square&& other) noexcept : side(other.side) {
+        ++alive;
+    }
+
+    ~Square() {
+        --alive;
+    }
+
+    double Area() const override {
+        return side * side;
+    }
+
+    void Scale(double factor) override {
+        side *= factor;
+    }
+
+    double side;
+};
+
+struct Named : Square {
+    Named(double side, std::string name) : Square(side), name(std::move(name)) {
+    }
+
+    std::string name;
+};
+
+TEMPLATE_TEST_CASE_SIG("ValuePtr", "", ((size_t Capacity), Capacity), 0, 64) {
+    SECTION("Deep copy") {
+        ValuePtr<Shape, Capacity> a(std::in_place_type<Square>, 2.0);
+        ValuePtr<Shape, Capacity> b = a;
+        REQUIRE(a.Get() != b.Get());
+        REQUIRE(Shape::alive == 2);
+
+        b->Scale(2);
+        REQUIRE(a->Area() == 4.0);
+        REQUIRE(b->Area() == 16.0);
+
+        a = b;
+        REQUIRE(a->Area() == 16.0);
+        REQUIRE(Shape::alive == 2);
+    }
+    REQUIRE(Shape::alive == 0);
+
+    SECTION("Copies keep the dynamic type") {
+        ValuePtr<Shape, Capacity> a(std::in_place_type<Named>, 1.0, "unit");
+        ValuePtr<Shape, Capacity> b = a;
+        REQUIRE(static_cast<const Named&>(*b).name == "unit");
+        REQUIRE(b.IsInline() == (Capacity > 0));
+    }
+    REQUIRE(Shape::alive == 0);
+
+    SECTION("Move and empty") {
+        ValuePtr<Shape, Capacity> a(std::in_place_type<Square>, 3.0);
+        ValuePtr<Shape, Capacity> b = std::move(a);
+        REQUIRE(!a);
+        REQUIRE(b->Area() == 9.0);
+
+        ValuePtr<Shape, Capacity> c = a;
+        REQUIRE(!c);
+        b = c;
+        REQUIRE(!b);
+        REQUIRE(Shape::alive == 0);
+    }
+}
+
+TEST_CASE("ValuePtr sizeof") {
+    static_assert(sizeof(ValuePtr<Shape>) == 2 * sizeof(void*));
+}
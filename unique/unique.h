@@ -2,7 +2,10 @@
 
 #include "compressed_pair.h"
 
+#include <common/pointer_hash.h>
+#include <common/relocatable.h>
 #include <cstddef>  // std::nullptr_t
+#include <functional>
 #include <type_traits>
 #include <utility>
 
@@ -35,6 +38,17 @@ struct DefaultDeleter<T[]> {
     }
 };
 
+// Deleter calling a function fixed at compile time: `FnDeleter<&fclose>`, or a captureless
+// lambda, `FnDeleter<[](T* ptr) { ... }>`. Unlike `void(*)(T*)`, it is empty, so `UniquePtr`
+// stays one pointer wide. A captureless lambda's own type works as an empty deleter as well
+template <auto Fn>
+struct FnDeleter {
+    template <typename T>
+    void operator()(T* ptr) const {
+        Fn(ptr);
+    }
+};
+
 // Primary template
 template <typename T, typename Deleter = DefaultDeleter<T>>
 class UniquePtr {
@@ -48,6 +62,8 @@ public:
     UniquePtr(T* ptr, Deleter deleter) : pair_ptr_deleter_(ptr, std::move(deleter)) {
     }
 
+    UniquePtr(const UniquePtr&) = delete;
+
     template <class OtherT, class OtherD>
     UniquePtr(UniquePtr<OtherT, OtherD>&& other) noexcept
         : pair_ptr_deleter_(other.Release(), std::forward<OtherD>(other.GetDeleter())) {
@@ -66,6 +82,8 @@ public:
        // pair_ptr_deleter_.GetFirst() = other.pair_ptr_deleter_.GetFirst();
        // почитать про std::exchange()
 
+    UniquePtr& operator=(const UniquePtr&) = delete;
+
     UniquePtr& operator=(std::nullptr_t) {
         pair_ptr_deleter_.GetSecond()(pair_ptr_deleter_.GetFirst());
         pair_ptr_deleter_.GetFirst() = nullptr;
@@ -155,6 +173,8 @@ public:
     UniquePtr(T* ptr, Deleter deleter) : pair_ptr_deleter_(ptr, std::move(deleter)) {
     }
 
+    UniquePtr(const UniquePtr&) = delete;
+
     template <class OtherT, class OtherD>
     UniquePtr(UniquePtr<OtherT, OtherD>&& other) noexcept
         : pair_ptr_deleter_(other.Release(), std::forward<OtherD>(other.GetDeleter())) {
@@ -172,6 +192,8 @@ public:
        // pair_ptr_deleter_.GetFirst() = other.pair_ptr_deleter_.GetFirst();
        // почитать про std::exchange()
 
+    UniquePtr& operator=(const UniquePtr&) = delete;
+
     UniquePtr& operator=(std::nullptr_t) {
         pair_ptr_deleter_.GetSecond()(pair_ptr_deleter_.GetFirst());
         pair_ptr_deleter_.GetFirst() = nullptr;
@@ -236,3 +258,19 @@ public:
 private:
     CompressedPair<T*, Deleter> pair_ptr_deleter_;
 };
+
+template <typename T, typename D, typename U, typename E>
+inline bool operator==(const UniquePtr<T, D>& left, const UniquePtr<U, E>& right) {
+    return left.Get() == right.Get();
+}
+
+// Bytes of the pointer and the deleter: relocatable as long as the deleter is
+template <typename T, typename Deleter>
+struct IsTriviallyRelocatable<UniquePtr<T, Deleter>> : IsTriviallyRelocatable<Deleter> {};
+
+template <typename T, typename Deleter>
+struct std::hash<UniquePtr<T, Deleter>> {
+    size_t operator()(const UniquePtr<T, Deleter>& ptr) const {
+        return MixPointer(ptr.Get());
+    }
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <type_traits>
+#include <utility>
+
+// Runtime description of a type held by `UniqueAny`: the destroy function, and the
+// address of the descriptor doubles as a type id. (The address of the destroy function
+// itself isn't a reliable id: the linker may fold identical functions together)
+struct AnyType {
+    void (*destroy)(void* object);
+};
+
+template <typename T>
+inline constexpr AnyType kAnyType = {
+    [](void* object) { delete static_cast<T*>(object); },
+};
+
+struct AnyDeleter {
+    void operator()(void* ptr) const {
+        type->destroy(ptr);
+    }
+
+    const AnyType* type = nullptr;
+};
+
+// Type-erased owner of a heap object of any type, move-only payloads included.
+// Two pointers wide: the object and its type descriptor
+class UniqueAny {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    UniqueAny() = default;
+
+    UniqueAny(std::nullptr_t) {
+    }
+
+    template <typename T, typename... Args>
+    explicit UniqueAny(std::in_place_type_t<T>, Args&&... args)
+        : ptr_(new T(std::forward<Args>(args)...), AnyDeleter{&kAnyType<T>}) {
+    }
+
+    // The object must be exactly a `T`, not something derived from it
+    template <typename T>
+    UniqueAny(UniquePtr<T>&& other) noexcept
+        : ptr_(other.Release(), AnyDeleter{&kAnyType<std::remove_cv_t<T>>}) {
+    }
+
+    UniqueAny(UniqueAny&& other) noexcept = default;
+
+    UniqueAny& operator=(UniqueAny&& other) noexcept = default;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        ptr_.Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    template <typename T>
+    bool Is() const {
+        return ptr_ && ptr_.GetDeleter().type == &kAnyType<std::remove_cv_t<T>>;
+    }
+
+    // Checked access: `nullptr` unless the object is a `T`
+    template <typename T>
+    T* As() {
+        return Is<T>() ? static_cast<T*>(ptr_.Get()) : nullptr;
+    }
+
+    template <typename T>
+    const T* As() const {
+        return Is<T>() ? static_cast<const T*>(ptr_.Get()) : nullptr;
+    }
+
+    void* Get() const {
+        return ptr_.Get();
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(ptr_);
+    }
+
+private:
+    UniquePtr<void, AnyDeleter> ptr_;
+};
+
+template <typename T, typename... Args>
+UniqueAny MakeUniqueAny(Args&&... args) {
+    return UniqueAny(std::in_place_type<T>, std::forward<Args>(args)...);
+}
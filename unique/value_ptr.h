@@ -0,0 +1,250 @@
+#pragma once
+
+#include "compressed_pair.h"
+#include "inplace_box.h"
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Deleter that also knows how to copy the concrete type, captured when the object is made.
+// Copies go straight to `D`'s copy constructor: no virtual `Clone()` needed.
+// Objects are made with the global `::new`, and destroyed as exactly `D` and freed with the
+// matching global `operator delete`, so `D` needs no virtual destructor either
+template <typename T>
+struct CloningDeleter {
+    struct Ops {
+        T* (*clone)(const T* object);
+        void (*destroy)(T* object);
+    };
+
+    template <typename D>
+    static void Destroy(T* object) {
+        D* derived = static_cast<D*>(object);
+        derived->~D();
+        if constexpr (alignof(D) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(derived, std::align_val_t(alignof(D)));
+        } else {
+            ::operator delete(derived);
+        }
+    }
+
+    template <typename D>
+    static constexpr Ops kOps = {
+        [](const T* object) -> T* { return ::new D(*static_cast<const D*>(object)); },
+        &Destroy<D>,
+    };
+
+    void operator()(T* ptr) const {
+        ops->destroy(ptr);
+    }
+
+    const Ops* ops = nullptr;
+};
+
+// Polymorphic value: owns a `T` (or something derived from it) and deep-copies it on copy.
+// `Capacity > 0` keeps objects up to that size inline, see `InplaceBox`
+template <typename T, size_t Capacity = 0>
+class ValuePtr {
+    using Box = InplaceBox<T, Capacity>;
+    using Copy = void (*)(const T& object, Box& target);
+
+    template <typename D>
+    static void CopyAs(const T& object, Box& target) {
+        target.template Emplace<D>(static_cast<const D&>(object));
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ValuePtr() = default;
+
+    ValuePtr(std::nullptr_t) {
+    }
+
+    template <typename D, typename... Args>
+    explicit ValuePtr(std::in_place_type_t<D>, Args&&... args)
+        : pair_box_copy_(Box(std::in_place_type<D>, std::forward<Args>(args)...), &CopyAs<D>) {
+        static_assert(std::is_copy_constructible_v<D>, "ValuePtr needs a copyable type");
+    }
+
+    ValuePtr(const ValuePtr& other) : pair_box_copy_(Box(), other.pair_box_copy_.GetSecond()) {
+        if (other) {
+            GetCopy()(*other, GetBox());
+        }
+    }
+
+    ValuePtr(ValuePtr&& other) noexcept
+        : pair_box_copy_(std::move(other.GetBox()), other.pair_box_copy_.GetSecond()) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ValuePtr& operator=(const ValuePtr& other) {
+        if (this != &other) {
+            ValuePtr copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    ValuePtr& operator=(ValuePtr&& other) noexcept {
+        GetBox() = std::move(other.GetBox());
+        pair_box_copy_.GetSecond() = other.pair_box_copy_.GetSecond();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        GetBox().Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() {
+        return GetBox().Get();
+    }
+
+    const T* Get() const {
+        return pair_box_copy_.GetFirst().Get();
+    }
+
+    T& operator*() {
+        return *Get();
+    }
+
+    const T& operator*() const {
+        return *Get();
+    }
+
+    T* operator->() {
+        return Get();
+    }
+
+    const T* operator->() const {
+        return Get();
+    }
+
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+
+    bool IsInline() const {
+        return pair_box_copy_.GetFirst().IsInline();
+    }
+
+private:
+    Box& GetBox() {
+        return pair_box_copy_.GetFirst();
+    }
+
+    Copy GetCopy() const {
+        return pair_box_copy_.GetSecond();
+    }
+
+    CompressedPair<Box, Copy> pair_box_copy_{Box(), nullptr};
+};
+
+// Heap-only mode: a `UniquePtr` whose deleter carries the copy
+template <typename T>
+class ValuePtr<T, 0> {
+    using Deleter = CloningDeleter<T>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ValuePtr() = default;
+
+    ValuePtr(std::nullptr_t) {
+    }
+
+    template <typename D, typename... Args>
+    explicit ValuePtr(std::in_place_type_t<D>, Args&&... args)
+        : ptr_(::new D(std::forward<Args>(args)...), Deleter{&Deleter::template kOps<D>}) {
+        static_assert(std::is_copy_constructible_v<D>, "ValuePtr needs a copyable type");
+    }
+
+    // The object must be exactly a `D`, not something derived from it, and `D` must not
+    // have its own `operator new`
+    template <typename D>
+    explicit ValuePtr(UniquePtr<D>&& other)
+        : ptr_(other.Release(), Deleter{&Deleter::template kOps<D>}) {
+        static_assert(std::is_copy_constructible_v<D>, "ValuePtr needs a copyable type");
+    }
+
+    ValuePtr(const ValuePtr& other)
+        : ptr_(other ? other.ptr_.GetDeleter().ops->clone(other.ptr_.Get()) : nullptr,
+               other.ptr_.GetDeleter()) {
+    }
+
+    ValuePtr(ValuePtr&& other) noexcept = default;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ValuePtr& operator=(const ValuePtr& other) {
+        if (this != &other) {
+            ValuePtr copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    ValuePtr& operator=(ValuePtr&& other) noexcept {
+        ptr_ = std::move(other.ptr_);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        ptr_.Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() {
+        return ptr_.Get();
+    }
+
+    const T* Get() const {
+        return ptr_.Get();
+    }
+
+    T& operator*() {
+        return *Get();
+    }
+
+    const T& operator*() const {
+        return *Get();
+    }
+
+    T* operator->() {
+        return Get();
+    }
+
+    const T* operator->() const {
+        return Get();
+    }
+
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+
+    bool IsInline() const {
+        return false;
+    }
+
+private:
+    UniquePtr<T, Deleter> ptr_;
+};
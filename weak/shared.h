@@ -48,14 +48,14 @@ public:
     }
 
     template <class Y>
-    SharedPtr(SharedPtr<Y>&& other) {
+    SharedPtr(SharedPtr<Y>&& other) noexcept {
         control_block_ = other.control_block_;
         ptr_ = other.ptr_;
         other.control_block_ = nullptr;
         other.ptr_ = nullptr;
     }
 
-    SharedPtr(SharedPtr&& other) {
+    SharedPtr(SharedPtr&& other) noexcept {
         control_block_ = other.control_block_;
         ptr_ = other.ptr_;
         other.control_block_ = nullptr;
@@ -103,7 +103,7 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr&& other) {
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
         if (this == &other) {
             return *this;
         }
@@ -144,7 +144,7 @@ public:
         ptr_ = ptr;
     }
 
-    void Swap(SharedPtr& other) {
+    void Swap(SharedPtr& other) noexcept {
         std::swap(control_block_, other.control_block_);
         std::swap(ptr_, other.ptr_);
     }